@@ -0,0 +1,216 @@
+/*
+ * The benchmark of the growth policies of a bus on a bursty trace.
+ * The producer pushes bursts of messages much faster than the consumer
+ * drains them, then it pauses until the consumer catches up. Every policy
+ * runs the same trace, the benchmark prints the count of connectors, the
+ * peak of the shared memory, the stalls on a full bus and the latency of
+ * pushes.
+ * Usage: bus_growth [bursts] [burst size] [message size] [drain per ms] [horizon ms]
+ */
+#include "qbus/bus.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <boost/lexical_cast.hpp>
+
+using namespace qbus;
+
+struct trace_type
+{
+    size_t bursts; ///< the count of bursts
+    size_t burst_size; ///< the count of messages in a burst
+    size_t message_size; ///< the size of a message
+    size_t drain_rate; ///< the count of messages the consumer pops per millisecond
+};
+
+struct result_type
+{
+    size_t connectors; ///< the count of made connectors
+    size_t peak_size; ///< the peak size of the shared memory of connectors
+    size_t stalls; ///< the count of pushes failed on a full bus
+    std::vector<uint64_t> latencies; ///< the latencies of pushes in nanoseconds
+};
+
+/**
+ * Get monotonic time
+ * @return monotonic time in nanoseconds
+ */
+static uint64_t time_ns()
+{
+    struct timespec res = { 0, 0 };
+    clock_gettime(CLOCK_MONOTONIC, &res);
+    return res.tv_sec * 1000000000ULL + res.tv_nsec;
+}
+
+/**
+ * Get the size of the shared memory of the connectors of the bus
+ * @param name the name of the bus
+ * @param connectors the count of made connectors
+ * @return the size of the shared memory
+ */
+static size_t segments_size(const std::string& name, size_t& connectors)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < connectors + 64; ++i)
+    {
+        struct stat st;
+        if (0 == stat(("/dev/shm/" + name + boost::lexical_cast<std::string>(i)).c_str(), &st))
+        {
+            result += st.st_size;
+            connectors = std::max(connectors, i + 1);
+        }
+    }
+    return result;
+}
+
+/**
+ * Drain the bus at the rate of the trace
+ * @param name the name of the bus
+ * @param trace the trace
+ */
+static void consume(const std::string& name, const trace_type& trace)
+{
+    pbus_type pbus = bus::make<single_input_bus_type>(name);
+    while (!pbus->open())
+    {
+        usleep(100);
+    }
+    const size_t count = trace.bursts * trace.burst_size;
+    const uint64_t period = 1000000 / trace.drain_rate;
+    uint64_t next = time_ns();
+    for (size_t i = 0; i < count; )
+    {
+        if (pbus->get())
+        {
+            pbus->pop();
+            ++i;
+            next += period;
+            const uint64_t now = time_ns();
+            if (next > now + 100000)
+            {
+                usleep((next - now) / 1000);
+            }
+        }
+        else
+        {
+            next = time_ns();
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * Run the trace on the bus with the growth policy
+ * @param name the name of the bus
+ * @param trace the trace
+ * @param ppolicy the growth policy
+ * @return the result of the run
+ */
+static result_type run(const std::string& name, const trace_type& trace,
+    const bus::pgrowth_policy_type& ppolicy)
+{
+    result_type result;
+    result.connectors = 0;
+    result.peak_size = 0;
+    result.stalls = 0;
+    pbus_type pbus = bus::make<single_output_bus_type>(name);
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.min_capacity = 64 * 1024;
+    spec.max_capacity = 64 * 1024 * 1024;
+    spec.capacity_factor = 50;
+    if (!pbus->create(spec))
+    {
+        return result;
+    }
+    pbus->policy(ppolicy);
+    const pid_t pid = fork();
+    if (0 == pid)
+    {
+        consume(name, trace);
+        _exit(0);
+    }
+    std::vector<uint8_t> buffer(trace.message_size, 1);
+    result.latencies.reserve(trace.bursts * trace.burst_size);
+    /* the consumer needs a burst and a half of time to drain a burst */
+    const uint64_t pause = 1500000ULL * trace.burst_size / trace.drain_rate;
+    for (size_t i = 0; i < trace.bursts; ++i)
+    {
+        for (size_t j = 0; j < trace.burst_size; ++j)
+        {
+            const uint64_t start = time_ns();
+            while (!pbus->push(j, &buffer[0], buffer.size()))
+            {
+                ++result.stalls;
+                sched_yield();
+            }
+            result.latencies.push_back(time_ns() - start);
+        }
+        result.peak_size = std::max(result.peak_size, segments_size(name, result.connectors));
+        usleep(pause / 1000);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+/**
+ * Get the percentile of the sorted latencies
+ * @param latencies the sorted latencies
+ * @param percent the percent
+ * @return the percentile
+ */
+static uint64_t percentile(const std::vector<uint64_t>& latencies, const double percent)
+{
+    if (latencies.empty())
+    {
+        return 0;
+    }
+    const size_t index = static_cast<size_t>(percent * (latencies.size() - 1) / 100);
+    return latencies[index];
+}
+
+static void print(const std::string& policy, const result_type& result)
+{
+    std::cout << std::setw(8) << policy
+        << std::setw(12) << result.connectors
+        << std::setw(12) << result.peak_size / 1024
+        << std::setw(10) << result.stalls
+        << std::setw(10) << percentile(result.latencies, 50)
+        << std::setw(10) << percentile(result.latencies, 99)
+        << std::setw(12) << percentile(result.latencies, 99.99)
+        << std::setw(12) << (result.latencies.empty() ? 0 : result.latencies.back())
+        << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    trace_type trace;
+    trace.bursts = argc > 1 ? atoi(argv[1]) : 10;
+    trace.burst_size = argc > 2 ? atoi(argv[2]) : 50000;
+    trace.message_size = argc > 3 ? atoi(argv[3]) : 256;
+    trace.drain_rate = argc > 4 ? atoi(argv[4]) : 500;
+    const size_t horizon = argc > 5 ? atoi(argv[5]) : 20;
+    std::cout << std::setw(8) << "policy"
+        << std::setw(12) << "connectors"
+        << std::setw(12) << "peak, KiB"
+        << std::setw(10) << "stalls"
+        << std::setw(10) << "p50, ns"
+        << std::setw(10) << "p99, ns"
+        << std::setw(12) << "p99.99, ns"
+        << std::setw(12) << "max, ns"
+        << std::endl;
+    print("factor", run("bus_growth_factor", trace,
+        boost::make_shared<bus::factor_growth_policy>()));
+    print("rate", run("bus_growth_rate", trace,
+        boost::make_shared<bus::rate_growth_policy>(horizon)));
+    return 0;
+}
@@ -9,6 +9,130 @@ namespace qbus
 namespace bus
 {
 
+//==============================================================================
+//  specification_type
+//==============================================================================
+/**
+ * Constructor
+ */
+specification_type::specification_type() :
+    id(0),
+    keepalive_timeout(0),
+    min_capacity(0),
+    max_capacity(0),
+    capacity_factor(0),
+    spare_count(0),
+    shrink_threshold(0),
+    shrink_timeout(0)
+{
+}
+
+//==============================================================================
+//  load_type
+//==============================================================================
+/**
+ * Constructor
+ */
+load_type::load_type() :
+    capacity(0),
+    usage(0),
+    backlog(0),
+    in_rate(0),
+    out_rate(0)
+{
+}
+
+//==============================================================================
+//  growth_policy
+//==============================================================================
+/**
+ * Destructor
+ */
+//virtual
+growth_policy::~growth_policy()
+{
+}
+
+/**
+ * Check if the bus must grow before the output connector is full
+ * @param spec the specification of the bus
+ * @param load the load of the bus
+ * @return the result of the checking
+ */
+//virtual
+bool growth_policy::grow_ahead(const specification_type& spec, const load_type& load) const
+{
+    QBUS_UNUSED(spec);
+    QBUS_UNUSED(load);
+    return false;
+}
+
+//==============================================================================
+//  factor_growth_policy
+//==============================================================================
+/**
+ * Get the capacity of the next connector
+ * @param spec the specification of the bus
+ * @param load the load of the bus
+ * @return the capacity of the next connector
+ */
+//virtual
+size_type factor_growth_policy::next_capacity(const specification_type& spec,
+    const load_type& load) const
+{
+    return std::min<uint64_t>(static_cast<uint64_t>(load.capacity) * (spec.capacity_factor + 100) / 100,
+        spec.max_capacity);
+}
+
+//==============================================================================
+//  rate_growth_policy
+//==============================================================================
+/**
+ * Constructor
+ * @param horizon the horizon of the projection in milliseconds
+ * @param lead the time in milliseconds the bus grows ahead of the saturation,
+ * it must exceed the sampling period of the rates
+ */
+rate_growth_policy::rate_growth_policy(const size_type horizon, const size_type lead) :
+    m_horizon(horizon),
+    m_lead(lead)
+{
+}
+
+/**
+ * Get the capacity of the next connector
+ * @param spec the specification of the bus
+ * @param load the load of the bus
+ * @return the capacity of the next connector
+ */
+//virtual
+size_type rate_growth_policy::next_capacity(const specification_type& spec,
+    const load_type& load) const
+{
+    const uint64_t input = static_cast<uint64_t>(load.in_rate) * m_horizon / 1000;
+    const uint64_t output = static_cast<uint64_t>(load.out_rate) * m_horizon / 1000;
+    const uint64_t peak = input - std::min(input, output > load.backlog ? output - load.backlog : 0);
+    return peak > load.capacity ? std::min<uint64_t>(peak, spec.max_capacity) :
+        factor_growth_policy::next_capacity(spec, load);
+}
+
+/**
+ * Check if the bus must grow before the output connector is full
+ * @param spec the specification of the bus
+ * @param load the load of the bus
+ * @return the result of the checking
+ */
+//virtual
+bool rate_growth_policy::grow_ahead(const specification_type& spec, const load_type& load) const
+{
+    QBUS_UNUSED(spec);
+    /* the consumer drains the output connector after the older ones */
+    const size_type drain = load.backlog > load.usage ? 0 : load.out_rate;
+    return load.in_rate > drain && load.usage < load.capacity &&
+        static_cast<uint64_t>(load.capacity - load.usage) * 1000 <
+            static_cast<uint64_t>(load.in_rate - drain) * m_lead;
+}
+
 //==============================================================================
 //  base_bus
 //==============================================================================
@@ -18,8 +142,22 @@ namespace bus
  */
 base_bus::base_bus(const std::string& name) :
     m_name(name),
+    m_output_id(0),
+    m_refilled_id(0),
+    m_shrinking(false),
+    m_underloaded(false),
+    m_ppolicy(boost::make_shared<factor_growth_policy>()),
+    m_pushed(0),
+    m_pushes(0),
+    m_pops(0),
+    m_sample_pushed(0),
+    m_sample_pushes(0),
+    m_sample_pops(0),
     m_opened(false)
 {
+    m_underload_time.tv_sec = 0;
+    m_underload_time.tv_nsec = 0;
+    m_sample_time = m_underload_time;
 }
 
 /**
@@ -84,23 +222,38 @@ bool base_bus::enabled() const
  * @return new connector
  */
 pconnector_type base_bus::make_connector(const id_type id) const
+{
+    return make_connector(id, !m_pconnectors.empty() ? output_connector() : pconnector_type());
+}
+
+/**
+ * Make new connector, it's bigger than its parent when the bus grows and
+ * smaller when the bus shrinks
+ * @param id the identifier of the connector
+ * @param pparent the connector that precedes the new one
+ * @return new connector
+ */
+pconnector_type base_bus::make_connector(const id_type id, pconnector_type pparent) const
 {
     pconnector_type pconnector = make_connector(m_name + boost::lexical_cast<std::string>(id));
-    if (pconnector->open(!m_pconnectors.empty() ? output_connector() : pconnector_type()))
+    if (pconnector->open(pparent))
     {
-        return pconnector;
+        /* the existing connector is a spare of another process, it isn't
+         * smaller, so the shrinking is postponed */
+        return !m_shrinking ? pconnector : pconnector_type();
     }
     const specification_type sp = spec();
-    if (m_pconnectors.empty() || sp.capacity_factor > 0)
+    if (!pparent || sp.capacity_factor > 0)
     {
         struct timespec timeout = { 0, 0 };
         timeout.tv_sec = sp.keepalive_timeout;
-        size_type old_capacity = !m_pconnectors.empty() ? output_connector()->capacity() : 0;
-        size_type new_capacity = std::max(sp.min_capacity, old_capacity * (sp.capacity_factor + 100) / 100);
-        new_capacity = std::min(new_capacity, sp.max_capacity);
-        if (new_capacity > old_capacity && 
-            pconnector->create(sp.id, new_capacity, timeout.tv_sec ? &timeout : NULL,
-                !m_pconnectors.empty() ? output_connector() : pconnector_type()))
+        size_type old_capacity = pparent ? pparent->capacity() : 0;
+        size_type new_capacity = !m_shrinking ?
+            m_ppolicy->next_capacity(sp, load(pparent)) :
+            static_cast<uint64_t>(old_capacity) * 100 / (sp.capacity_factor + 100);
+        new_capacity = std::min(std::max(sp.min_capacity, new_capacity), sp.max_capacity);
+        if ((!m_shrinking ? new_capacity > old_capacity : new_capacity < old_capacity) &&
+            pconnector->create(sp.id, new_capacity, timeout.tv_sec ? &timeout : NULL, pparent))
         {
             return pconnector;
         }
@@ -108,6 +261,162 @@ pconnector_type base_bus::make_connector(const id_type id) const
     return NULL;
 }
 
+/**
+ * Take the spare connector, the spares that don't follow the output
+ * connector any more are dropped
+ * @param id the identifier of the connector
+ * @return the spare connector or NULL
+ */
+pconnector_type base_bus::take_spare(const id_type id) const
+{
+    if (!m_pspares.empty() && m_output_id + 1 == id)
+    {
+        pconnector_type pconnector = m_pspares.front();
+        m_pspares.pop_front();
+        return pconnector;
+    }
+    m_pspares.clear();
+    return NULL;
+}
+
+/**
+ * Follow the load of the bus after a push: sample its rates, let the growth
+ * policy grow it ahead of the saturation and shrink it when it's idle
+ * @param size the size of the pushed data
+ */
+void base_bus::follow_load(const size_t size)
+{
+    m_pushed += size;
+    if (0 == ++m_pushes % SAMPLE_MESSAGES)
+    {
+        sample_load();
+    }
+    shrink();
+}
+
+/**
+ * Sample the rates of the bus. The producers add up their pushed bytes and
+ * messages in the control block, the consumers add up their popped messages.
+ * The popped bytes are estimated with the mean size of the pushed messages,
+ * since a pop doesn't see the size. Each producer samples its own view no
+ * more often than `SAMPLE_PERIOD` and averages it with the rates in the
+ * control block.
+ */
+void base_bus::sample_load()
+{
+    using namespace boost::interprocess::ipcdetail;
+    const struct timespec now = get_monotonic_time();
+    const struct timespec elapsed = now - m_sample_time;
+    const uint64_t us = elapsed.tv_sec * 1000000 + elapsed.tv_nsec / 1000;
+    if (us < SAMPLE_PERIOD * 1000)
+    {
+        return;
+    }
+    controlblock_type& cb = get_controlblock();
+    const uint32_t pushed = atomic_add32(&cb.pushed, m_pushed) + m_pushed;
+    const uint32_t pushes = atomic_add32(&cb.pushes, m_pushes) + m_pushes;
+    const uint32_t pops = atomic_read32(&cb.pops);
+    if ((m_sample_time.tv_sec != 0 || m_sample_time.tv_nsec != 0) && pushes != m_sample_pushes)
+    {
+        const uint64_t in = static_cast<uint32_t>(pushed - m_sample_pushed);
+        const uint64_t size = in / static_cast<uint32_t>(pushes - m_sample_pushes);
+        const uint64_t out = static_cast<uint32_t>(pops - m_sample_pops) * size;
+        /* the pops are counted at once, the pushes of other producers later */
+        const int32_t messages = static_cast<int32_t>(pushes - pops);
+        atomic_write32(&cb.backlog, messages > 0 ? messages * size : 0);
+        atomic_write32(&cb.in_rate, (atomic_read32(&cb.in_rate) + in * 1000000 / us) / 2);
+        atomic_write32(&cb.out_rate, (atomic_read32(&cb.out_rate) + out * 1000000 / us) / 2);
+    }
+    m_pushed = 0;
+    m_pushes = 0;
+    m_sample_pushed = pushed;
+    m_sample_pushes = pushes;
+    m_sample_pops = pops;
+    m_sample_time = now;
+    if (can_add_connector() && m_ppolicy->grow_ahead(spec(), load(pconnector_type())))
+    {
+        add_connector();
+    }
+}
+
+/**
+ * Count the popped message, the consumer adds up its pops in the control
+ * block by `SAMPLE_MESSAGES`
+ */
+void base_bus::count_pop()
+{
+    if (SAMPLE_MESSAGES == ++m_pops)
+    {
+        boost::interprocess::ipcdetail::atomic_add32(&get_controlblock().pops, m_pops);
+        m_pops = 0;
+    }
+}
+
+/**
+ * Get the load of the bus
+ * @param pparent the connector that is followed by the new one or NULL
+ * @return the load of the bus
+ */
+load_type base_bus::load(const pconnector_type& pparent) const
+{
+    using namespace boost::interprocess::ipcdetail;
+    load_type result;
+    if (!m_pconnectors.empty())
+    {
+        const pconnector_type poutput = output_connector();
+        result.capacity = pparent ? pparent->capacity() : poutput->capacity();
+        result.usage = poutput->usage();
+    }
+    controlblock_type& cb = get_controlblock();
+    result.backlog = std::max<size_type>(atomic_read32(&cb.backlog), result.usage);
+    result.in_rate = atomic_read32(&cb.in_rate);
+    result.out_rate = atomic_read32(&cb.out_rate);
+    return result;
+}
+
+/**
+ * Shrink the bus after the occupancy of its output connector stays below
+ * `shrink_threshold` for `shrink_timeout` seconds. The next connector gets
+ * the capacity of the output one divided by the growth step, the consumer
+ * leaves the big connector when it's drained. It's a hysteresis: the bus
+ * grows when its connector is full, it shrinks only when the connector is
+ * the only one and is underloaded for a while, so the threshold should be
+ * less than 100 * 100 / (`capacity_factor` + 100) percents to keep the
+ * smaller connector from being full at once.
+ */
+void base_bus::shrink()
+{
+    const specification_type& sp = spec();
+    if (0 == sp.shrink_threshold)
+    {
+        return;
+    }
+    const pconnector_type pconnector = output_connector();
+    const size_t cpct = pconnector->capacity();
+    if (cpct <= sp.min_capacity || can_remove_connector() ||
+        static_cast<uint64_t>(pconnector->usage()) * 100 >= static_cast<uint64_t>(cpct) * sp.shrink_threshold)
+    {
+        m_underloaded = false;
+        return;
+    }
+    const struct timespec now = get_monotonic_time();
+    if (!m_underloaded)
+    {
+        m_underloaded = true;
+        m_underload_time = now;
+        return;
+    }
+    struct timespec timeout = { 0, 0 };
+    timeout.tv_sec = sp.shrink_timeout;
+    if (now - m_underload_time >= timeout && can_add_connector())
+    {
+        m_underloaded = false;
+        rollback<bool> shrinking(m_shrinking);
+        m_shrinking = true;
+        add_connector();
+    }
+}
+
 /**
  * Check if a new connector can be added
  * @return result of the checking
@@ -126,11 +435,19 @@ bool base_bus::can_add_connector() const
 bool base_bus::add_connector() const
 {
     controlblock_type& cb = get_controlblock();
-    pconnector_type pconnector = make_connector(cb.output_id + 1);
+    pconnector_type pconnector = !m_shrinking ? take_spare(cb.output_id + 1) : pconnector_type();
+    if (m_shrinking)
+    {
+        m_pspares.clear();
+    }
+    if (!pconnector)
+    {
+        pconnector = make_connector(cb.output_id + 1);
+    }
     if (pconnector)
     {
         m_pconnectors.push_front(pconnector);
-        ++cb.output_id;
+        m_output_id = ++cb.output_id;
         ++cb.epoch;
         return true;
     }
@@ -197,6 +514,113 @@ const specification_type& base_bus::spec() const
     return get_spec();
 }
 
+/**
+ * Return the memory pages of free regions of all connectors to the OS
+ * @return the size of the returned memory
+ */
+size_t base_bus::reclaim()
+{
+    size_t result = 0;
+    if (m_opened)
+    {
+        for (std::list<pconnector_type>::iterator it = m_pconnectors.begin();
+            it != m_pconnectors.end(); ++it)
+        {
+            result += (*it)->reclaim();
+        }
+    }
+    return result;
+}
+
+/**
+ * Make the spare connectors ahead of the growth of the bus, so the growth
+ * takes a ready connector instead of creating, truncating and faulting in
+ * a new shared memory object under the lock of the bus. The spares are
+ * prefaulted and follow the capacity policy of the bus, so their count may
+ * be less than `spare_count` near `max_capacity`. The bus makes them when
+ * it's created or opened, the consumer tops them up after the bus grows,
+ * while the producer does it itself when it's idle (the spares of another
+ * process still save the creating, the producer just maps them).
+ * @return the count of made connectors
+ */
+size_t base_bus::refill()
+{
+    return m_opened ? do_refill() : 0;
+}
+
+/**
+ * Set the growth policy of the bus, the policy of a process applies to the
+ * connectors that it adds
+ * @param ppolicy the growth policy
+ */
+void base_bus::policy(const pgrowth_policy_type& ppolicy)
+{
+    m_ppolicy = ppolicy;
+}
+
+/**
+ * Make the spare connectors
+ * @return the count of made connectors
+ */
+//virtual
+size_t base_bus::do_refill()
+{
+    return add_spares();
+}
+
+/**
+ * Make the spare connectors that follow the output connector
+ * @return the count of made connectors
+ */
+//virtual
+size_t base_bus::add_spares() const
+{
+    const size_t count = spec().spare_count;
+    const id_type input_id = get_controlblock().input_id;
+    size_t result = 0;
+    m_refilled_id = m_output_id;
+    while (m_pspares.size() < count)
+    {
+        const id_type id = m_output_id + 1 + m_pspares.size();
+        if (id == input_id)
+        {
+            break;
+        }
+        pconnector_type pconnector = make_connector(id,
+            !m_pspares.empty() ? m_pspares.back() : output_connector());
+        if (!pconnector)
+        {
+            break;
+        }
+        pconnector->prefault();
+        m_pspares.push_back(pconnector);
+        ++result;
+    }
+    return result;
+}
+
+/**
+ * Get the descriptor that becomes readable after messages are pushed, so
+ * the bus can be waited on in an event loop among other descriptors.
+ * The first call subscribes the bus, then messages must be got until the
+ * bus is empty every time the descriptor becomes readable.
+ * @return the descriptor or -1 if the bus doesn't support it
+ */
+int base_bus::native_handle() const
+{
+    return m_opened ? do_native_handle() : -1;
+}
+
+/**
+ * Get the descriptor that becomes readable after pushes
+ * @return the descriptor or -1
+ */
+//virtual
+int base_bus::do_native_handle() const
+{
+    return -1;
+}
+
 /**
  * Push data to the bus
  * @param tag the tag of the data
@@ -215,6 +639,7 @@ bool base_bus::push(const tag_type tag, const void *data, const size_t size)
                 return false;
             }
         }
+        follow_load(size);
         return true;
     }
     return false;
@@ -240,6 +665,7 @@ bool base_bus::push(const tag_type tag, const void *data, const size_t size,
                 return false;
             }
         }
+        follow_load(size);
         return true;
     }
     return false;
@@ -297,6 +723,11 @@ bool base_bus::pop()
                 return false;
             }
         }
+        count_pop();
+        if (m_refilled_id != m_output_id)
+        {
+            refill();
+        }
         return true;
     }
     return false;
@@ -318,6 +749,11 @@ bool base_bus::pop(const struct timespec& timeout)
                 return false;
             }
         }
+        count_pop();
+        if (m_refilled_id != m_output_id)
+        {
+            refill();
+        }
         return true;
     }
     return false;
@@ -406,6 +842,8 @@ bool base_bus::do_create(const specification_type& spec)
     if (pconnector)
     {
         m_pconnectors.push_front(pconnector);
+        m_output_id = 0;
+        base_bus::add_spares();
         return true;
     }
     return false;
@@ -430,6 +868,8 @@ bool base_bus::do_open()
         }
         m_pconnectors.push_front(pconnector);
     } while (id++ != cb.output_id);
+    m_output_id = cb.output_id;
+    base_bus::add_spares();
     return true;
 }
 
@@ -438,6 +878,7 @@ bool base_bus::do_open()
  */
 void base_bus::close()
 {
+    m_pspares.clear();
     m_pconnectors.clear();
 }
 
@@ -525,6 +966,12 @@ bool shared_bus::create_body(const specification_type& spec)
     pbody->controlblock.epoch = 0;
     pbody->controlblock.output_id = 0;
     pbody->controlblock.input_id = 0;
+    pbody->controlblock.pushed = 0;
+    pbody->controlblock.pushes = 0;
+    pbody->controlblock.pops = 0;
+    pbody->controlblock.backlog = 0;
+    pbody->controlblock.in_rate = 0;
+    pbody->controlblock.out_rate = 0;
     m_controlblock = pbody->controlblock;
     if (base_type::do_create(spec))
     {
@@ -780,6 +1227,17 @@ bool shared_bus::add_connector() const
     return result;
 }
 
+/**
+ * Make the spare connectors after catching up with the growth of the bus
+ * @return the count of made connectors
+ */
+//virtual
+size_t shared_bus::do_refill()
+{
+    update_output_connector();
+    return base_type::do_refill();
+}
+
 /**
  * Remove the back connector from the bus
  * @return result of the removing
@@ -3,6 +3,7 @@
 
 #include "qbus/connector.h"
 #include "qbus/locker.h"
+#include "qbus/notifier.h"
 #include <string>
 #include <list>
 #include <boost/shared_ptr.hpp>
@@ -22,11 +23,15 @@ typedef pos_type size_type;
 
 struct specification_type
 {
+    specification_type();
     id_type id; ///< the identifier of a bus
     size_type keepalive_timeout; ///< the maximum idle time before forcibly removing a message
     size_type min_capacity; ///< the minimum value of a bus capacity
     size_type max_capacity; ///< the maximum value of a bus capacity
     size_type capacity_factor; ///< the new value of bus capacity will be = capacity * (capacity_factor + 100) / 100
+    size_type spare_count; ///< the count of connectors made ahead of the growth of the bus
+    size_type shrink_threshold; ///< the occupancy in percents of the capacity below which the bus shrinks, 0 disables it
+    size_type shrink_timeout; ///< the time in seconds the occupancy must stay below the threshold before the bus shrinks
 };
 
 struct controlblock_type
@@ -34,6 +39,69 @@ struct controlblock_type
     uint32_t epoch; ///< the epoch of the control block
     id_type input_id; ///< the connector identifier for getting data
     id_type output_id; ///< the connector identifier for pushing data
+    uint32_t pushed; ///< the count of pushed bytes, it wraps
+    uint32_t pushes; ///< the count of pushed messages, it wraps
+    uint32_t pops; ///< the count of popped messages, it wraps
+    uint32_t backlog; ///< the estimated busy space of all connectors
+    uint32_t in_rate; ///< the rate of pushing in bytes per second
+    uint32_t out_rate; ///< the rate of popping in bytes per second
+};
+
+/**
+ * The load of a bus that the growth policy looks at
+ */
+struct load_type
+{
+    load_type();
+    size_type capacity; ///< the capacity of the connector that is followed by the new one
+    size_type usage; ///< the busy space of the output connector
+    size_type backlog; ///< the estimated busy space of all connectors
+    size_type in_rate; ///< the rate of pushing in bytes per second
+    size_type out_rate; ///< the rate of popping in bytes per second
+};
+
+/**
+ * The growth policy of a bus, it chooses the capacity of the next connector
+ * and may let the bus grow before its output connector is full. The result
+ * is bounded by `min_capacity` and `max_capacity`, and the bus doesn't grow
+ * if it isn't bigger than the capacity of the output connector.
+ */
+class growth_policy
+{
+public:
+    virtual ~growth_policy();
+    virtual size_type next_capacity(const specification_type& spec, const load_type& load) const = 0; ///< get the capacity of the next connector
+    virtual bool grow_ahead(const specification_type& spec, const load_type& load) const; ///< check if the bus must grow before the output connector is full
+};
+
+typedef boost::shared_ptr<growth_policy> pgrowth_policy_type;
+
+/**
+ * The growth policy that multiplies the capacity by `capacity_factor`
+ */
+class factor_growth_policy : public growth_policy
+{
+public:
+    virtual size_type next_capacity(const specification_type& spec, const load_type& load) const; ///< get the capacity of the next connector
+};
+
+/**
+ * The growth policy that follows the rates of pushing and popping. The
+ * next connector gets the peak of the data it will hold within the
+ * horizon: the consumer drains the backlog before it, while the producer
+ * fills it with the whole input. The bus grows ahead when the output
+ * connector is going to be full within the lead time. Without the rates,
+ * or when they don't need more space, it falls back to `capacity_factor`.
+ */
+class rate_growth_policy : public factor_growth_policy
+{
+public:
+    explicit rate_growth_policy(const size_type horizon, const size_type lead = 2);
+    virtual size_type next_capacity(const specification_type& spec, const load_type& load) const; ///< get the capacity of the next connector
+    virtual bool grow_ahead(const specification_type& spec, const load_type& load) const; ///< check if the bus must grow before the output connector is full
+private:
+    const size_type m_horizon; ///< the horizon of the projection in milliseconds
+    const size_type m_lead; ///< the time in milliseconds the bus grows ahead of the saturation
 };
 
 /**
@@ -55,10 +123,16 @@ public:
     bool pop(const struct timespec& timeout); ///< remove the next message from the bus
     bool enabled() const; ///< check if the bus is enabled
     const specification_type& spec() const; ///< get the specification of the bus
+    size_t reclaim(); ///< return the memory pages of free regions to the OS
+    size_t refill(); ///< make the spare connectors ahead of the growth of the bus
+    void policy(const pgrowth_policy_type& ppolicy); ///< set the growth policy of the bus
+    int native_handle() const; ///< get the descriptor that becomes readable after pushes
 protected:
     virtual bool do_create(const specification_type& spec); ///< create the bus
     virtual bool do_open(); ///< open the bus
     void close(); ///< close the bus
+    virtual int do_native_handle() const; ///< get the descriptor that becomes readable after pushes
+    virtual size_t do_refill(); ///< make the spare connectors
     virtual bool do_push(const tag_type tag, const void *data, const size_t size); ///< push data to the bus
     virtual bool do_timed_push(const tag_type tag, const void *data, const size_t size, const struct timespec& timeout); ///< push data to the bus
     virtual const pmessage_type do_get() const; ///< get the next message from the bus
@@ -69,16 +143,43 @@ protected:
     virtual controlblock_type& get_controlblock() const = 0; ///< get the control block of the bus
     virtual bool add_connector() const; ///< add new connector to the bus
     virtual bool remove_connector() const; ///< remove the back connector from the bus
+    virtual size_t add_spares() const; ///< make the spare connectors
     bool can_add_connector() const; ///< check if a new connector can be added
     bool can_remove_connector() const; ///< check if the back connector can be removed
 private:
+    enum
+    {
+        SAMPLE_MESSAGES = 16, ///< the count of messages between the checks of the sampling time
+        SAMPLE_PERIOD = 1 ///< the minimal period of sampling the rates in milliseconds
+    };
     virtual pconnector_type make_connector(const std::string& name) const = 0; ///< make new connector
     pconnector_type make_connector(const id_type id) const; ///< make new connector
+    pconnector_type make_connector(const id_type id, pconnector_type pparent) const; ///< make new connector
+    pconnector_type take_spare(const id_type id) const; ///< take the spare connector
+    void follow_load(const size_t size); ///< follow the load of the bus after a push
+    void sample_load(); ///< sample the rates of the bus
+    void count_pop(); ///< count the popped message in the control block
+    void shrink(); ///< shrink the bus after its load stays low for a while
+    load_type load(const pconnector_type& pparent) const; ///< get the load of the bus
     pconnector_type output_connector() const; ///< get the output connector
     pconnector_type input_connector() const; ///< get the input connector
 private:
     const std::string m_name;
     mutable std::list<pconnector_type> m_pconnectors;
+    mutable std::list<pconnector_type> m_pspares; ///< the connectors made ahead of the growth
+    mutable id_type m_output_id; ///< the identifier of the local output connector
+    mutable id_type m_refilled_id; ///< the identifier of the output connector at the last refilling
+    mutable bool m_shrinking; ///< the next connector is smaller than the output one
+    bool m_underloaded; ///< the occupancy of the output connector is below the threshold
+    struct timespec m_underload_time; ///< the time since the output connector is underloaded
+    pgrowth_policy_type m_ppolicy; ///< the growth policy
+    uint32_t m_pushed; ///< the bytes pushed since the last sample
+    uint32_t m_pushes; ///< the messages pushed since the last sample
+    uint32_t m_pops; ///< the messages popped since they were counted in the control block
+    uint32_t m_sample_pushed; ///< the pushed bytes of the bus at the last sample
+    uint32_t m_sample_pushes; ///< the pushed messages of the bus at the last sample
+    uint32_t m_sample_pops; ///< the popped messages of the bus at the last sample
+    struct timespec m_sample_time; ///< the time of the last sample
     bool m_opened;
 };
 
@@ -116,6 +217,7 @@ protected:
     controlblock_type& get_shared_controlblock() const; ///< get the shared control block of the bus
     virtual bool add_connector() const; ///< add new connector to the bus
     virtual bool remove_connector() const; ///< remove the back connector from the bus
+    virtual size_t do_refill(); ///< make the spare connectors
 private:
     enum update_status
     {
@@ -209,10 +311,16 @@ protected:
     virtual size_t memory_size() const; ///< get the size of the shared memory
     virtual bool add_connector() const; ///< add new connector to the bus
     virtual bool remove_connector() const; ///< remove the back connector from the bus
+    virtual size_t add_spares() const; ///< make the spare connectors
+    virtual bool do_push(const tag_type tag, const void *data, const size_t size); ///< push data to the bus
+    virtual bool do_timed_push(const tag_type tag, const void *data, const size_t size, const struct timespec& timeout); ///< push data to the bus
+    virtual const pmessage_type do_get() const; ///< get the next message from the bus
+    virtual int do_native_handle() const; ///< get the descriptor that becomes readable after pushes
 private:
     typedef Locker locker_type;
     typedef scoped_lock<locker_type> scoped_lock_type;
     mutable locker_type *m_plocker;
+    notifier m_notifier;
 };
 
 typedef boost::shared_ptr<base_bus> pbus_type;
@@ -399,6 +507,7 @@ base_safe_bus<Bus, Locker>::~base_safe_bus()
             scoped_lock_type lock(*m_plocker);
             base_type::close();
         }
+        m_notifier.close();
         if (--(*pcounter) == 0)
         {
             m_plocker->~locker_type();
@@ -425,6 +534,7 @@ bool base_safe_bus<Bus, Locker>::do_create(const specification_type& spec)
         volatile uint32_t *pcounter = reinterpret_cast<volatile uint32_t*>(ptr);
         ptr += sizeof(uint32_t);
         m_plocker = new (ptr) locker_type();
+        m_notifier.create_table(ptr + sizeof(locker_type), base_type::name());
         scoped_lock_type lock(*m_plocker);
         if (base_type::create_body(spec))
         {
@@ -455,6 +565,7 @@ bool base_safe_bus<Bus, Locker>::do_open()
         {
             ptr += sizeof(uint32_t);
             m_plocker = reinterpret_cast<locker_type*>(ptr);
+            m_notifier.open_table(ptr + sizeof(locker_type), base_type::name());
             scoped_lock_type lock(*m_plocker);
             if (base_type::attach_body())
             {
@@ -475,7 +586,7 @@ template <typename Bus, typename Locker>
 void *base_safe_bus<Bus, Locker>::get_memory() const
 {
     return reinterpret_cast<uint8_t*>(base_type::get_memory()) + 
-        sizeof(locker_type) + sizeof(uint32_t);
+        sizeof(locker_type) + notifier::table_size() + sizeof(uint32_t);
 }
 
 /**
@@ -486,7 +597,8 @@ void *base_safe_bus<Bus, Locker>::get_memory() const
 template <typename Bus, typename Locker>
 size_t base_safe_bus<Bus, Locker>::memory_size() const
 {
-    return base_type::memory_size() + sizeof(locker_type) + sizeof(uint32_t);
+    return base_type::memory_size() + sizeof(locker_type) +
+        notifier::table_size() + sizeof(uint32_t);
 }
 
 /**
@@ -513,6 +625,88 @@ bool base_safe_bus<Bus, Locker>::remove_connector() const
     return base_type::remove_connector();
 }
 
+/**
+ * Make the spare connectors
+ * @return the count of made connectors
+ */
+//virtual
+template <typename Bus, typename Locker>
+size_t base_safe_bus<Bus, Locker>::add_spares() const
+{
+    scoped_lock_type lock(*m_plocker);
+    return base_type::add_spares();
+}
+
+/**
+ * Push data to the bus
+ * @param tag the tag of the data
+ * @param data the data
+ * @param size the size of the data
+ * @return result of the pushing
+ */
+//virtual
+template <typename Bus, typename Locker>
+bool base_safe_bus<Bus, Locker>::do_push(const tag_type tag, const void *data,
+    const size_t size)
+{
+    if (base_type::do_push(tag, data, size))
+    {
+        m_notifier.notify();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Push data to the bus
+ * @param tag the tag of the data
+ * @param data the data
+ * @param size the size of the data
+ * @param timeout the allowable timeout of the pushing
+ * @return result of the pushing
+ */
+//virtual
+template <typename Bus, typename Locker>
+bool base_safe_bus<Bus, Locker>::do_timed_push(const tag_type tag, const void *data,
+    const size_t size, const struct timespec& timeout)
+{
+    if (base_type::do_timed_push(tag, data, size, timeout))
+    {
+        m_notifier.notify();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Get the next message from the bus
+ * @return the message
+ */
+//virtual
+template <typename Bus, typename Locker>
+const pmessage_type base_safe_bus<Bus, Locker>::do_get() const
+{
+    pmessage_type pmessage = base_type::do_get();
+    if (!pmessage && m_notifier.acknowledge())
+    {
+        /* the messages pushed before the acknowledgement are not signalled,
+         * so the bus must be checked again */
+        pmessage = base_type::do_get();
+    }
+    return pmessage;
+}
+
+/**
+ * Get the descriptor that becomes readable after pushes
+ * @return the descriptor or -1
+ */
+//virtual
+template <typename Bus, typename Locker>
+int base_safe_bus<Bus, Locker>::do_native_handle() const
+{
+    return m_notifier.native_handle();
+}
+
 } //namespace bus
 
 typedef bus::base_safe_bus<bus::single_input_bus_type> single_input_bus_type;
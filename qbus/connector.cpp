@@ -191,6 +191,111 @@ size_t base_connector::capacity() const
     return m_opened ? get_capacity() : 0;
 }
 
+/**
+ * Get the size of the busy space of the connector, it's approximate since
+ * the connector isn't locked
+ * @return the size of the busy space of the connector
+ */
+size_t base_connector::usage() const
+{
+    return m_opened ? get_usage() : 0;
+}
+
+/**
+ * Get the size of the busy space of the connector
+ * @return the size of the busy space of the connector
+ */
+//virtual
+size_t base_connector::get_usage() const
+{
+    return 0;
+}
+
+/**
+ * Return the memory pages of free regions to the OS
+ * It is a maintenance operation that should be called from time to time
+ * when the connector is idle, e.g. after a burst of messages is drained
+ * @return the size of the returned memory
+ */
+size_t base_connector::reclaim()
+{
+    return m_opened ? do_reclaim() : 0;
+}
+
+/**
+ * Return the memory pages of free regions to the OS
+ * @return the size of the returned memory
+ */
+//virtual
+size_t base_connector::do_reclaim()
+{
+    return 0;
+}
+
+/**
+ * Populate the memory pages of the connector, so the first pushes to it
+ * don't fault. It's useful for a connector made ahead of its use.
+ * @return the size of the populated memory
+ */
+size_t base_connector::prefault()
+{
+    return m_opened ? do_prefault() : 0;
+}
+
+/**
+ * Populate the memory pages of the connector
+ * @return the size of the populated memory
+ */
+//virtual
+size_t base_connector::do_prefault()
+{
+    return 0;
+}
+
+/**
+ * Flush the connector to its backing store
+ * It is a checkpoint after that all pushed messages are durable when the
+ * connector is placed in a persistent memory
+ * @return the result of the flushing
+ */
+bool base_connector::flush()
+{
+    return m_opened ? do_flush() : false;
+}
+
+/**
+ * Flush the connector to its backing store
+ * @return the result of the flushing
+ */
+//virtual
+bool base_connector::do_flush()
+{
+    return true;
+}
+
+/**
+ * Get the descriptor that becomes readable after messages are pushed, so
+ * the connector can be waited on in an event loop among other descriptors.
+ * The first call subscribes the connector, then messages must be got until
+ * the connector is empty every time the descriptor becomes readable.
+ * @return the descriptor or -1 if the connector doesn't support it
+ */
+int base_connector::native_handle() const
+{
+    return (m_opened && (CON_IN == m_type || CON_BIDIR == m_type)) ?
+        do_native_handle() : -1;
+}
+
+/**
+ * Get the descriptor that becomes readable after pushes
+ * @return the descriptor or -1
+ */
+//virtual
+int base_connector::do_native_handle() const
+{
+    return -1;
+}
+
 /**
  * Push data to the connector
  * @param tag the tag of the data
@@ -260,137 +365,5 @@ bool base_connector::do_timed_pop(const struct timespec& timeout)
     return false;
 }
 
-//==============================================================================
-//  shared_connector
-//==============================================================================
-/**
- * Constructor
- * @param name the name of the connector
- * @param type the type of the connector
- */
-shared_connector::shared_connector(const std::string& name, const direction_type type) :
-    base_connector(name, type),
-    m_memory(name)
-{
-}
-
-/**
- * Create the connector
- * @param cid the identifier of the connector
- * @param size the size of a queue
- * @param pkeepalive_timeout the keep alive timeout of the connector
- * @param pconnector the parent connector
- * @return the result of the creating
- */
-//virtual
-bool shared_connector::do_create(const id_type cid, const size_t size,
-    const struct timespec *pkeepalive_timeout, pconnector_type pconnector)
-{
-    QBUS_UNUSED(cid);
-    QBUS_UNUSED(pkeepalive_timeout);
-    QBUS_UNUSED(pconnector);
-    return create_memory(size);
-}
-
-/**
- * Open the connector
- * @param pconnector the parent connector
- * @return the result of the opening
- */
-//virtual
-bool shared_connector::do_open(pconnector_type pconnector)
-{
-    QBUS_UNUSED(pconnector);
-    return open_memory();
-}
-
-/**
- * Create the shared memory
- * @param size the size of shared memory
- * @return the result of the creating
- */
-bool shared_connector::create_memory(const size_t size)
-{
-    return m_memory.create(memory_size(size));
-}
-
-/**
- * Open the shared memory
- * @return the result of the opening
- */
-bool shared_connector::open_memory()
-{
-    return m_memory.open();
-}
-
-/**
- * Get the pointer to the shared memory
- * @return the pointer to the shared memory
- */
-//virtual
-void *shared_connector::get_memory() const
-{
-    return m_memory.get();
-}
-
-//==============================================================================
-//  sharable_barrier
-//==============================================================================
-/**
- * Get size of the barrier
- * @return size of the barrier
- */
-//static
-size_t sharable_barrier::barrier_size()
-{
-    return sizeof(barrier_type);
-}
-
-/**
- * Constructor
- */
-sharable_barrier::sharable_barrier() :
-    m_pbarrier(NULL)
-{}
-
-/**
- * Get the barrier
- * @return the barrier
- */
-sharable_barrier::barrier_type& sharable_barrier::barrier() const
-{
-    return *m_pbarrier;
-}
-
-/**
- * Create the barrier
- * @param ptr pointer to the place where this barrier will be built
- * @return pointer to memory region after this barrier
- */
-void *sharable_barrier::create_barrier(void *ptr)
-{
-    m_pbarrier = new (ptr) barrier_type();
-    return reinterpret_cast<uint8_t*>(ptr) + sizeof(barrier_type);
-}
-
-/**
- * Open the barrier
- * @param ptr pointer to the place where this barrier is located
- * @return pointer to memory region after this barrier
- */
-void *sharable_barrier::open_barrier(void *ptr)
-{
-    m_pbarrier = reinterpret_cast<barrier_type*>(ptr);;
-    return reinterpret_cast<uint8_t*>(ptr) + sizeof(barrier_type);
-}
-
-/**
- * Free the barrier
- */
-void sharable_barrier::free_barrier()
-{
-    m_pbarrier->~barrier_type();
-}
-
 } //namespace connector
 } //namespace qbus
\ No newline at end of file
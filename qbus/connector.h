@@ -4,6 +4,7 @@
 #include "qbus/queue.h"
 #include "qbus/memory.h"
 #include "qbus/locker.h"
+#include "qbus/notifier.h"
 #include "qbus/common.h"
 #include <time.h>
 #include <string>
@@ -12,6 +13,7 @@
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/interprocess_upgradable_mutex.hpp>
+#include <boost/interprocess/detail/atomic.hpp>
 
 namespace qbus
 {
@@ -59,6 +61,11 @@ public:
     bool pop(const struct timespec& timeout); ///< remove the next message from the connector
     bool enabled() const; ///< check if the connected is enabled
     size_t capacity() const; ///< get the capacity of the connector
+    size_t usage() const; ///< get the size of the busy space of the connector
+    size_t reclaim(); ///< return the memory pages of free regions to the OS
+    size_t prefault(); ///< populate the memory pages of the connector
+    bool flush(); ///< flush the connector to its backing store
+    int native_handle() const; ///< get the descriptor that becomes readable after pushes
 protected:
     virtual bool do_create(const id_type cid, const size_t size,
         const struct timespec *pkeepalive_timeout, pconnector_type pconnector) = 0; ///< create the connector
@@ -70,6 +77,11 @@ protected:
     virtual bool do_pop() = 0; ///< remove the next message from the connector
     virtual bool do_timed_pop(const struct timespec& timeout); ///< remove the next message from the connector
     virtual size_t get_capacity() const = 0; ///< get the capacity of the connector
+    virtual size_t get_usage() const; ///< get the size of the busy space of the connector
+    virtual size_t do_reclaim(); ///< return the memory pages of free regions to the OS
+    virtual size_t do_prefault(); ///< populate the memory pages of the connector
+    virtual bool do_flush(); ///< flush the connector to its backing store
+    virtual int do_native_handle() const; ///< get the descriptor that becomes readable after pushes
 private:
     bool create(const id_type cid, const size_t size, 
         const struct timespec *pkeepalive_timeout, pconnector_type pconnector); ///< create the connector
@@ -86,29 +98,35 @@ typedef connector_type::pconnector_type pconnector_type;
 /**
  * The shared connector
  */
+template <typename Memory>
 class shared_connector : public base_connector
 {
 public:
+    typedef Memory memory_type;
     shared_connector(const std::string& name, const direction_type type);
 protected:
     virtual bool do_create(const id_type cid, const size_t size, 
         const struct timespec *pkeepalive_timeout, pconnector_type pconnector); ///< create the connector
     virtual bool do_open(pconnector_type pconnector); ///< open the connector
+    virtual size_t do_prefault(); ///< populate the memory pages of the connector
+    virtual bool do_flush(); ///< flush the connector to its backing store
     virtual void *get_memory() const; ///< get the pointer to the shared memory
     virtual size_t memory_size(const size_t size) const = 0; ///< get the size of the shared memory
     bool create_memory(const size_t size); ///< create the shared memory
     bool open_memory(); ///< open the shared memory
+    bool exclusive_memory() const; ///< check if nobody else is attached to the shared memory
+    void share_memory(); ///< let other connectors attach to the shared memory
 private:
-    shared_memory_type m_memory;
+    memory_type m_memory;
 };
 
 /**
  * The simple connector
  */
-template <typename Queue>
-class simple_connector : public shared_connector
+template <typename Queue, typename Memory = shared_memory_type>
+class simple_connector : public shared_connector<Memory>
 {
-    typedef shared_connector base_type;
+    typedef shared_connector<Memory> base_type;
     typedef Queue queue_type;
 public:
     simple_connector(const std::string& name, const direction_type type);
@@ -121,6 +139,11 @@ protected:
     virtual const pmessage_type do_get() const; ///< get the next message from the connector
     virtual bool do_pop(); ///< remove the next message from the connector
     virtual size_t get_capacity() const; ///< get the capacity of the connector
+    virtual size_t get_usage() const; ///< get the size of the busy space of the connector
+    virtual size_t do_reclaim(); ///< return the memory pages of free regions to the OS
+    bool empty_queue() const; ///< check if the queue is empty
+    bool expiring_queue() const; ///< check if a push removes expired messages
+    void repair_queue() const; ///< recount the messages after a crash of a writer
     void create_queue(const id_type cid, const size_t size, 
         const struct timespec *pkeepalive_timeout, pconnector_type pconnector); ///< create the queue
     void open_queue(pconnector_type pconnector); ///< open the queue
@@ -132,6 +155,7 @@ private:
 typedef simple_connector<queue::simple_queue> single_bidirectional_connector_type;
 typedef simple_connector<queue::shared_queue> multi_bidirectional_connector_type;
 typedef simple_connector<queue::unreadable_shared_queue> multi_output_connector_type;
+typedef simple_connector<queue::simple_queue, mapped_file_type> persistent_single_bidirectional_connector_type;
 
 /**
  * The output connector
@@ -171,6 +195,41 @@ public:
     explicit bidirectional_connector(const std::string& name);
 };
 
+/**
+ * The sharable barrier 
+ */
+template <typename Barrier>
+class basic_sharable_barrier
+{
+public:
+    typedef Barrier barrier_type;
+    basic_sharable_barrier();
+    barrier_type& barrier() const; ///< get the barrier
+    void *create_barrier(void *ptr); ///< create the barrier
+    void *open_barrier(void *ptr); ///< open the barrier
+    void free_barrier(); ///< free the barrier
+    static size_t barrier_size(); ///< get size of the barrier
+protected:
+    mutable barrier_type *m_pbarrier; ///< pointer to the barrier
+};
+
+typedef basic_sharable_barrier<shared_barrier> sharable_barrier;
+typedef basic_sharable_barrier<shared_futex_barrier> sharable_futex_barrier;
+
+/**
+ * The stub barrier
+ */
+class stub_barrier
+{
+public:
+    typedef void barrier_type;
+    void barrier() const {}
+    void *create_barrier(void *ptr) { return ptr; }
+    void *open_barrier(void *ptr) { return ptr; }
+    void free_barrier() {}
+    static size_t barrier_size() { return 0; }
+};
+
 /**
  * The base locker interface
  */
@@ -178,6 +237,7 @@ template <bool B>
 struct base_locker_interface
 {
     static const bool has_timed_lock = B;
+    typedef sharable_barrier barrier_interface_type; ///< the barrier of the timed operations
 };
 
 /**
@@ -249,12 +309,13 @@ public:
 };
 
 /**
- * The sharable POSIX locker interface based on pthread_rwlock_t
+ * The sharable futex locker interface
  */
-class sharable_posixlocker_interface : public base_locker_interface<true>
+class sharable_futexlocker_interface : public base_locker_interface<true>
 {
 public:
-    typedef shared_posix_locker locker_type;
+    typedef shared_futex_locker locker_type;
+    typedef sharable_futex_barrier barrier_interface_type;
     typedef scoped_lock<locker_type> scoped_lock_type;
     typedef sharable_lock<locker_type> sharable_lock_type;
     typedef scoped_try_lock<locker_type> lock_to_push_type;
@@ -263,12 +324,13 @@ public:
 };
 
 /**
- * The sharable POSIX locker interface to a connector that has a sharable pop operation
+ * The sharable futex locker interface to a connector that has a sharable pop operation
  */
-class sharable_posixlocker_with_sharable_pop_interface : public base_locker_interface<true>
+class sharable_futexlocker_with_sharable_pop_interface : public base_locker_interface<true>
 {
 public:
-    typedef shared_posix_locker locker_type;
+    typedef shared_futex_locker locker_type;
+    typedef sharable_futex_barrier barrier_interface_type;
     typedef scoped_lock<locker_type> scoped_lock_type;
     typedef sharable_lock<locker_type> sharable_lock_type;
     typedef scoped_try_lock<locker_type> lock_to_push_type;
@@ -277,34 +339,122 @@ public:
 };
 
 /**
- * The sharable barrier 
+ * The sharable phase-fair locker interface, the producer waits for its turn
+ * instead of trying, so polling consumers can't starve it
  */
-class sharable_barrier
+class sharable_fairlocker_interface : public base_locker_interface<true>
 {
 public:
-    typedef shared_barrier barrier_type;
-    sharable_barrier();
-    barrier_type& barrier() const; ///< get the barrier
-    void *create_barrier(void *ptr); ///< create the barrier
-    void *open_barrier(void *ptr); ///< open the barrier
-    void free_barrier(); ///< free the barrier
-    static size_t barrier_size(); ///< get size of the barrier
-protected:
-    mutable barrier_type *m_pbarrier; ///< pointer to the barrier
+    typedef shared_fair_locker locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef scoped_lock<locker_type> lock_to_push_type;
+    typedef scoped_try_lock<locker_type> lock_to_pop_type;
+    typedef sharable_try_lock<locker_type> lock_to_get_type;
 };
 
 /**
- * The stub barrier
+ * The sharable phase-fair locker interface to a connector that has a sharable pop operation
  */
-class stub_barrier
+class sharable_fairlocker_with_sharable_pop_interface : public base_locker_interface<true>
 {
 public:
-    typedef void barrier_type;
-    void barrier() const {}
-    void *create_barrier(void *ptr) { return ptr; }
-    void *open_barrier(void *ptr) { return ptr; }
-    void free_barrier() {}
-    static size_t barrier_size() { return 0; }
+    typedef shared_fair_locker locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef scoped_lock<locker_type> lock_to_push_type;
+    typedef sharable_try_lock<locker_type> lock_to_pop_type;
+    typedef sharable_try_lock<locker_type> lock_to_get_type;
+};
+
+/**
+ * The dual spin locker interface, producers and consumers of the queue take
+ * separate lockers and publish the tail and the head atomically, so a push
+ * runs alongside a get or a pop. Its timed operations poll, because a push
+ * can't open the barrier atomically with the knock of a consumer that it
+ * doesn't exclude.
+ */
+class dual_spinlocker_interface : public base_locker_interface<false>
+{
+public:
+    typedef shared_dual_locker<shared_locker> locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef producer_try_lock<locker_type> lock_to_push_type;
+    typedef consumer_try_lock<locker_type, scoped_lock<shared_locker> > lock_to_pop_type;
+    typedef consumer_try_lock<locker_type, sharable_lock<shared_locker> > lock_to_get_type;
+};
+
+/**
+ * The dual spin locker interface to a connector that has a sharable pop operation
+ */
+class dual_spinlocker_with_sharable_pop_interface : public dual_spinlocker_interface
+{
+public:
+    typedef consumer_try_lock<locker_type, sharable_lock<shared_locker> > lock_to_pop_type;
+    typedef consumer_try_lock<locker_type, sharable_lock<shared_locker> > lock_to_get_type;
+};
+
+/**
+ * The robust locker interface, a connector survives a process that dies
+ * holding its locker, the next owner of the locker repairs the queue.
+ * Its timed operations poll instead of parking on a barrier, because a
+ * waiter that dies on a barrier leaves a wakeup nobody takes.
+ */
+class robust_locker_interface : public base_locker_interface<false>
+{
+public:
+    typedef shared_robust_locker locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef scoped_try_lock<locker_type> lock_to_push_type;
+    typedef scoped_try_lock<locker_type> lock_to_pop_type;
+    typedef sharable_try_lock<locker_type> lock_to_get_type;
+};
+
+/**
+ * The priority-inheriting locker interface for real-time consumers. All its
+ * operations block on the locker instead of trying it, because only
+ * a blocked waiter lends its priority to the owner. Its timed operations
+ * poll, the WaitStrategy of a real-time consumer should be busy_spin_wait.
+ */
+class pi_locker_interface : public base_locker_interface<false>
+{
+public:
+    typedef shared_pi_locker locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef scoped_lock<locker_type> lock_to_push_type;
+    typedef scoped_lock<locker_type> lock_to_pop_type;
+    typedef sharable_lock<locker_type> lock_to_get_type;
+};
+
+/**
+ * The sharable POSIX locker interface based on pthread_rwlock_t
+ */
+class sharable_posixlocker_interface : public base_locker_interface<true>
+{
+public:
+    typedef shared_posix_locker locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef scoped_try_lock<locker_type> lock_to_push_type;
+    typedef scoped_try_lock<locker_type> lock_to_pop_type;
+    typedef sharable_try_lock<locker_type> lock_to_get_type;
+};
+
+/**
+ * The sharable POSIX locker interface to a connector that has a sharable pop operation
+ */
+class sharable_posixlocker_with_sharable_pop_interface : public base_locker_interface<true>
+{
+public:
+    typedef shared_posix_locker locker_type;
+    typedef scoped_lock<locker_type> scoped_lock_type;
+    typedef sharable_lock<locker_type> sharable_lock_type;
+    typedef scoped_try_lock<locker_type> lock_to_push_type;
+    typedef sharable_try_lock<locker_type> lock_to_pop_type;
+    typedef sharable_try_lock<locker_type> lock_to_get_type;
 };
 
 /**
@@ -333,16 +483,32 @@ protected:
     virtual bool do_push(const tag_type tag, const void *data, const size_t size); ///< push data to the connector
     virtual const pmessage_type do_get() const; ///< get the next message from the connector
     virtual bool do_pop(); ///< remove the next message from the connector
+    virtual size_t do_reclaim(); ///< return the memory pages of free regions to the OS
+    virtual bool do_flush(); ///< flush the connector to its backing store
+    virtual int do_native_handle() const; ///< get the descriptor that becomes readable after pushes
     locker_type& locker() const; ///< get the locker
+    const Barrier& space_barrier() const; ///< get the barrier of free space
+    void notify(); ///< signal the subscribers of the native handle
+    volatile uint32_t& sequence() const; ///< get the sequence of changes of the queue
+    bool optimistic_empty() const; ///< check without the locker that the connector is empty
+    void recover() const; ///< repair the connector if a writer died holding the locker
+private:
+    void *create_sequence(void *ptr); ///< create the sequence of changes
+    void *open_sequence(void *ptr); ///< open the sequence of changes
 private:
     mutable locker_type *m_plocker;
+    Barrier m_space_barrier; ///< producers wait on it until a pop frees space
+    notifier m_notifier;
+    volatile uint32_t *m_psequence; ///< it's odd while the queue is being changed
 };
 
 /**
- * The safe connector for inter process communications
+ * The safe connector for inter process communications, the WaitStrategy
+ * decides how the timed operations idle between polls: busy_spin_wait,
+ * spin_yield_wait or spin_park_wait
  */
 template <typename Connector, typename Locker = sharable_locker_interface,
-    bool B = Locker::has_timed_lock>
+    typename WaitStrategy = spin_park_wait, bool B = Locker::has_timed_lock>
 class safe_connector : public base_safe_connector<Connector, Locker, stub_barrier>
 {
     typedef base_safe_connector<Connector, Locker, stub_barrier> base_type;
@@ -354,16 +520,21 @@ class safe_connector : public base_safe_connector<Connector, Locker, stub_barrie
     typedef typename base_type::lock_to_pop_type lock_to_pop_type;
 public:
     explicit safe_connector(const std::string& name) : base_type(name) {}
+protected:
+    virtual bool do_timed_push(const tag_type tag, const void *data, const size_t size, const struct timespec& timeout); ///< push data to the connector
+    virtual const pmessage_type do_timed_get(const struct timespec& timeout) const; ///< get the next message from the connector
+    virtual bool do_timed_pop(const struct timespec& timeout); ///< remove the next message from the connector
 };
 
 /**
  * The safe connector for inter process communications
  */
-template <typename Connector, typename Locker>
-class safe_connector<Connector, Locker, true> : public base_safe_connector<Connector, Locker, sharable_barrier>
+template <typename Connector, typename Locker, typename WaitStrategy>
+class safe_connector<Connector, Locker, WaitStrategy, true> : 
+    public base_safe_connector<Connector, Locker, typename Locker::barrier_interface_type>
 {
     typedef Connector connector_type;
-    typedef base_safe_connector<Connector, Locker, sharable_barrier> base_type;
+    typedef base_safe_connector<Connector, Locker, typename Locker::barrier_interface_type> base_type;
     typedef typename base_type::locker_type locker_type;
     typedef typename base_type::scoped_lock_type scoped_lock_type;
     typedef typename base_type::sharable_lock_type sharable_lock_type;
@@ -373,6 +544,7 @@ class safe_connector<Connector, Locker, true> : public base_safe_connector<Conne
 public:
     explicit safe_connector(const std::string& name);
     virtual bool do_push(const tag_type tag, const void *data, const size_t size); ///< push data to the connector
+    virtual bool do_pop(); ///< remove the next message from the connector
     virtual bool do_timed_push(const tag_type tag, const void *data, const size_t size, const struct timespec& timeout); ///< push data to the connector
     virtual const pmessage_type do_timed_get(const struct timespec& timeout) const; ///< get the next message from the connector
     virtual bool do_timed_pop(const struct timespec& timeout); ///< remove the next message from the connector
@@ -389,6 +561,126 @@ const pconnector_type make(const std::string& name)
     return boost::make_shared<Connector>(name);
 }
 
+//==============================================================================
+//  shared_connector
+//==============================================================================
+/**
+ * Constructor
+ * @param name the name of the connector
+ * @param type the type of the connector
+ */
+template <typename Memory>
+shared_connector<Memory>::shared_connector(const std::string& name, const direction_type type) :
+    base_connector(name, type),
+    m_memory(name)
+{
+}
+
+/**
+ * Create the connector
+ * @param cid the identifier of the connector
+ * @param size the size of a queue
+ * @param pkeepalive_timeout the keep alive timeout of the connector
+ * @param pconnector the parent connector
+ * @return the result of the creating
+ */
+//virtual
+template <typename Memory>
+bool shared_connector<Memory>::do_create(const id_type cid, const size_t size,
+    const struct timespec *pkeepalive_timeout, pconnector_type pconnector)
+{
+    QBUS_UNUSED(cid);
+    QBUS_UNUSED(pkeepalive_timeout);
+    QBUS_UNUSED(pconnector);
+    return create_memory(size);
+}
+
+/**
+ * Open the connector
+ * @param pconnector the parent connector
+ * @return the result of the opening
+ */
+//virtual
+template <typename Memory>
+bool shared_connector<Memory>::do_open(pconnector_type pconnector)
+{
+    QBUS_UNUSED(pconnector);
+    return open_memory();
+}
+
+/**
+ * Populate the memory pages of the connector
+ * @return the size of the populated memory
+ */
+//virtual
+template <typename Memory>
+size_t shared_connector<Memory>::do_prefault()
+{
+    return memory::prefault(m_memory.get(), m_memory.size());
+}
+
+/**
+ * Flush the connector to its backing store
+ * @return the result of the flushing
+ */
+//virtual
+template <typename Memory>
+bool shared_connector<Memory>::do_flush()
+{
+    return m_memory.flush();
+}
+
+/**
+ * Create the shared memory
+ * @param size the size of shared memory
+ * @return the result of the creating
+ */
+template <typename Memory>
+bool shared_connector<Memory>::create_memory(const size_t size)
+{
+    return m_memory.create(memory_size(size));
+}
+
+/**
+ * Open the shared memory
+ * @return the result of the opening
+ */
+template <typename Memory>
+bool shared_connector<Memory>::open_memory()
+{
+    return m_memory.open();
+}
+
+/**
+ * Check if nobody else is attached to the shared memory
+ * @return the result of the checking
+ */
+template <typename Memory>
+bool shared_connector<Memory>::exclusive_memory() const
+{
+    return m_memory.exclusive();
+}
+
+/**
+ * Let other connectors attach to the shared memory
+ */
+template <typename Memory>
+void shared_connector<Memory>::share_memory()
+{
+    m_memory.share();
+}
+
+/**
+ * Get the pointer to the shared memory
+ * @return the pointer to the shared memory
+ */
+//virtual
+template <typename Memory>
+void *shared_connector<Memory>::get_memory() const
+{
+    return m_memory.get();
+}
+
 //==============================================================================
 //  simple_connector
 //==============================================================================
@@ -397,8 +689,8 @@ const pconnector_type make(const std::string& name)
  * @param name the name of the connector
  * @param type the type of the connector
  */
-template <typename Queue>
-simple_connector<Queue>::simple_connector(const std::string& name, const direction_type type) :
+template <typename Queue, typename Memory>
+simple_connector<Queue, Memory>::simple_connector(const std::string& name, const direction_type type) :
     base_type(name, type)
 {
 }
@@ -412,8 +704,8 @@ simple_connector<Queue>::simple_connector(const std::string& name, const directi
  * @return the result of the creating
  */
 //virtual
-template <typename Queue>
-bool simple_connector<Queue>::do_create(const id_type cid, const size_t size,
+template <typename Queue, typename Memory>
+bool simple_connector<Queue, Memory>::do_create(const id_type cid, const size_t size,
     const struct timespec *pkeepalive_timeout, pconnector_type pconnector)
 {
     if (base_type::do_create(cid, size, pkeepalive_timeout, pconnector))
@@ -430,8 +722,8 @@ bool simple_connector<Queue>::do_create(const id_type cid, const size_t size,
  * @return the result of the opening
  */
 //virtual
-template <typename Queue>
-bool simple_connector<Queue>::do_open(pconnector_type pconnector)
+template <typename Queue, typename Memory>
+bool simple_connector<Queue, Memory>::do_open(pconnector_type pconnector)
 {
     if (base_type::do_open(pconnector))
     {
@@ -448,13 +740,13 @@ bool simple_connector<Queue>::do_open(pconnector_type pconnector)
  * @param pkeepalive_timeout the keep alive timeout of the queue
  * @param pconnector the parent connector
  */
-template <typename Queue>
-void simple_connector<Queue>::create_queue(const id_type cid, const size_t size, 
+template <typename Queue, typename Memory>
+void simple_connector<Queue, Memory>::create_queue(const id_type cid, const size_t size, 
     const struct timespec *pkeepalive_timeout, pconnector_type pconnector)
 {
-    m_pqueue = queue::create<queue_type>(cid, get_memory(), size, 
+    m_pqueue = queue::create<queue_type>(cid, this->get_memory(), size, 
         pconnector ? 
-            static_cast<simple_connector<Queue>*>(pconnector.get())->m_pqueue :
+            static_cast<simple_connector<Queue, Memory>*>(pconnector.get())->m_pqueue :
             pqueue_type());
     if (pkeepalive_timeout != NULL)
     {
@@ -466,20 +758,20 @@ void simple_connector<Queue>::create_queue(const id_type cid, const size_t size,
  * Open the queue
  * @param pconnector the parent connector
  */
-template <typename Queue>
-void simple_connector<Queue>::open_queue(pconnector_type pconnector)
+template <typename Queue, typename Memory>
+void simple_connector<Queue, Memory>::open_queue(pconnector_type pconnector)
 {
-    m_pqueue = queue::open<queue_type>(get_memory(), 
+    m_pqueue = queue::open<queue_type>(this->get_memory(), 
         pconnector ? 
-            static_cast<simple_connector<Queue>*>(pconnector.get())->m_pqueue :
+            static_cast<simple_connector<Queue, Memory>*>(pconnector.get())->m_pqueue :
             pqueue_type());
 }
 
 /**
  * Free the queue
  */
-template <typename Queue>
-void simple_connector<Queue>::free_queue()
+template <typename Queue, typename Memory>
+void simple_connector<Queue, Memory>::free_queue()
 {
     m_pqueue.reset();
 }
@@ -490,8 +782,8 @@ void simple_connector<Queue>::free_queue()
  * @return the size of the shared memory
  */
 //virtual
-template <typename Queue>
-size_t simple_connector<Queue>::memory_size(const size_t size) const
+template <typename Queue, typename Memory>
+size_t simple_connector<Queue, Memory>::memory_size(const size_t size) const
 {
     return queue_type::static_size(size);
 }
@@ -504,8 +796,8 @@ size_t simple_connector<Queue>::memory_size(const size_t size) const
  * @return result of the pushing
  */
 //virtual
-template <typename Queue>
-bool simple_connector<Queue>::do_push(const tag_type tag, const void *data, const size_t size)
+template <typename Queue, typename Memory>
+bool simple_connector<Queue, Memory>::do_push(const tag_type tag, const void *data, const size_t size)
 {
     return m_pqueue->push(tag, data, size);
 }
@@ -515,8 +807,8 @@ bool simple_connector<Queue>::do_push(const tag_type tag, const void *data, cons
  * @return the message
  */
 //virtual
-template <typename Queue>
-const pmessage_type simple_connector<Queue>::do_get() const
+template <typename Queue, typename Memory>
+const pmessage_type simple_connector<Queue, Memory>::do_get() const
 {
     return m_pqueue->get();
 }
@@ -526,8 +818,8 @@ const pmessage_type simple_connector<Queue>::do_get() const
  * @return the result of the removing
  */
 //virtual
-template <typename Queue>
-bool simple_connector<Queue>::do_pop()
+template <typename Queue, typename Memory>
+bool simple_connector<Queue, Memory>::do_pop()
 {
     return m_pqueue->pop();
 }
@@ -537,12 +829,64 @@ bool simple_connector<Queue>::do_pop()
  * @return the capacity of the connector
  */
 //virtual
-template <typename Queue>
-size_t simple_connector<Queue>::get_capacity() const
+template <typename Queue, typename Memory>
+size_t simple_connector<Queue, Memory>::get_capacity() const
 {
     return m_pqueue->capacity();
 }
 
+/**
+ * Get the size of the busy space of the connector
+ * @return the size of the busy space of the connector
+ */
+//virtual
+template <typename Queue, typename Memory>
+size_t simple_connector<Queue, Memory>::get_usage() const
+{
+    return m_pqueue->usage();
+}
+
+/**
+ * Check if the queue is empty
+ * @return the result of the checking
+ */
+template <typename Queue, typename Memory>
+bool simple_connector<Queue, Memory>::empty_queue() const
+{
+    return m_pqueue->empty();
+}
+
+/**
+ * Check if a push removes expired messages, so it works on the head of
+ * the queue too
+ * @return the result of the checking
+ */
+template <typename Queue, typename Memory>
+bool simple_connector<Queue, Memory>::expiring_queue() const
+{
+    return m_pqueue->keepalive_timeout() > 0;
+}
+
+/**
+ * Recount the messages after a crash of a writer
+ */
+template <typename Queue, typename Memory>
+void simple_connector<Queue, Memory>::repair_queue() const
+{
+    m_pqueue->repair();
+}
+
+/**
+ * Return the memory pages of free regions to the OS
+ * @return the size of the returned memory
+ */
+//virtual
+template <typename Queue, typename Memory>
+size_t simple_connector<Queue, Memory>::do_reclaim()
+{
+    return m_pqueue->reclaim();
+}
+
 //==============================================================================
 //  output_connector
 //==============================================================================
@@ -667,6 +1011,72 @@ bidirectional_connector<Connector>::bidirectional_connector(const std::string& n
 {
 }
 
+//==============================================================================
+//  basic_sharable_barrier
+//==============================================================================
+/**
+ * Get size of the barrier
+ * @return size of the barrier
+ */
+//static
+template <typename Barrier>
+size_t basic_sharable_barrier<Barrier>::barrier_size()
+{
+    return sizeof(barrier_type);
+}
+
+/**
+ * Constructor
+ */
+template <typename Barrier>
+basic_sharable_barrier<Barrier>::basic_sharable_barrier() :
+    m_pbarrier(NULL)
+{}
+
+/**
+ * Get the barrier
+ * @return the barrier
+ */
+template <typename Barrier>
+typename basic_sharable_barrier<Barrier>::barrier_type& 
+    basic_sharable_barrier<Barrier>::barrier() const
+{
+    return *m_pbarrier;
+}
+
+/**
+ * Create the barrier
+ * @param ptr pointer to the place where this barrier will be built
+ * @return pointer to memory region after this barrier
+ */
+template <typename Barrier>
+void *basic_sharable_barrier<Barrier>::create_barrier(void *ptr)
+{
+    m_pbarrier = new (ptr) barrier_type();
+    return reinterpret_cast<uint8_t*>(ptr) + sizeof(barrier_type);
+}
+
+/**
+ * Open the barrier
+ * @param ptr pointer to the place where this barrier is located
+ * @return pointer to memory region after this barrier
+ */
+template <typename Barrier>
+void *basic_sharable_barrier<Barrier>::open_barrier(void *ptr)
+{
+    m_pbarrier = reinterpret_cast<barrier_type*>(ptr);
+    return reinterpret_cast<uint8_t*>(ptr) + sizeof(barrier_type);
+}
+
+/**
+ * Free the barrier
+ */
+template <typename Barrier>
+void basic_sharable_barrier<Barrier>::free_barrier()
+{
+    m_pbarrier->~barrier_type();
+}
+
 //==============================================================================
 //  base_safe_connector
 //==============================================================================
@@ -677,7 +1087,8 @@ bidirectional_connector<Connector>::bidirectional_connector(const std::string& n
 template <typename Connector, typename Locker, typename Barrier>
 base_safe_connector<Connector, Locker, Barrier>::base_safe_connector(const std::string& name) :
     base_type(name),
-    m_plocker(NULL)
+    m_plocker(NULL),
+    m_psequence(NULL)
 {
 }
 
@@ -699,9 +1110,11 @@ base_safe_connector<Connector, Locker, Barrier>::~base_safe_connector()
             scoped_lock_type lock(*m_plocker);
             base_type::free_queue();
         }
+        m_notifier.close();
         if (--(*pcounter) == 0)
         {
             Barrier::free_barrier();
+            m_space_barrier.free_barrier();
             m_plocker->~locker_type();
         }
     }
@@ -733,10 +1146,15 @@ bool base_safe_connector<Connector, Locker, Barrier>::do_create(const id_type ci
         m_plocker = new (ptr) locker_type();
         ptr += sizeof(locker_type);
         ptr = reinterpret_cast<uint8_t*>(Barrier::create_barrier(ptr));
+        ptr = reinterpret_cast<uint8_t*>(m_space_barrier.create_barrier(ptr));
+        ptr = reinterpret_cast<uint8_t*>(m_notifier.create_table(ptr, base_type::name()));
+        ptr = reinterpret_cast<uint8_t*>(create_sequence(ptr));
         scoped_lock_type lock(*m_plocker);
         base_type::create_queue(cid, size, pkeepalive_timeout, pconnector);
+        exclusive_push(*m_plocker, base_type::expiring_queue());
         ++(*pcounter);
         pspinlock->unlock();
+        base_type::share_memory();
         return true;
     }
     return false;
@@ -756,17 +1174,44 @@ bool base_safe_connector<Connector, Locker, Barrier>::do_open(pconnector_type pc
         uint8_t *ptr = reinterpret_cast<uint8_t*>(base_type::get_memory());
         spinlock *pspinlock = reinterpret_cast<spinlock*>(ptr);
         ptr += sizeof(spinlock);
-        scoped_lock<spinlock> guard(*pspinlock);
         volatile uint32_t *pcounter = reinterpret_cast<volatile uint32_t*>(ptr);
-        if (*pcounter > 0)
+        const bool rebuilt = base_type::exclusive_memory();
+        if (rebuilt)
+        {
+            /* nobody is attached to the persistent memory, the locks may be
+             * left by a crashed process, so they must be rebuilt while the
+             * queue keeps its data */
+            pspinlock->unlock();
+            *pcounter = 0;
+        }
+        scoped_lock<spinlock> guard(*pspinlock);
+        ptr += sizeof(uint32_t);
+        if (rebuilt)
+        {
+            m_plocker = new (ptr) locker_type();
+            ptr += sizeof(locker_type);
+            ptr = reinterpret_cast<uint8_t*>(Barrier::create_barrier(ptr));
+            ptr = reinterpret_cast<uint8_t*>(m_space_barrier.create_barrier(ptr));
+            ptr = reinterpret_cast<uint8_t*>(m_notifier.create_table(ptr, base_type::name()));
+            ptr = reinterpret_cast<uint8_t*>(create_sequence(ptr));
+        }
+        else if (*pcounter > 0)
         {
-            ptr += sizeof(uint32_t);
             m_plocker = reinterpret_cast<locker_type*>(ptr);
             ptr += sizeof(locker_type);
             ptr = reinterpret_cast<uint8_t*>(Barrier::open_barrier(ptr));
+            ptr = reinterpret_cast<uint8_t*>(m_space_barrier.open_barrier(ptr));
+            ptr = reinterpret_cast<uint8_t*>(m_notifier.open_table(ptr, base_type::name()));
+            ptr = reinterpret_cast<uint8_t*>(open_sequence(ptr));
+        }
+        if (m_plocker != NULL)
+        {
             scoped_lock_type lock(*m_plocker);
             base_type::open_queue(pconnector);
+            recover();
+            exclusive_push(*m_plocker, base_type::expiring_queue());
             ++(*pcounter);
+            base_type::share_memory();
             return true;
         }
     }
@@ -782,8 +1227,8 @@ template <typename Connector, typename Locker, typename Barrier>
 void *base_safe_connector<Connector, Locker, Barrier>::get_memory() const
 {
     return reinterpret_cast<uint8_t*>(base_type::get_memory()) +
-        sizeof(locker_type) + Barrier::barrier_size() + sizeof(spinlock) + 
-        sizeof(uint32_t);
+        sizeof(locker_type) + 2 * Barrier::barrier_size() + notifier::table_size() +
+        sizeof(uint32_t) + sizeof(spinlock) + sizeof(uint32_t);
 }
 
 /**
@@ -796,7 +1241,8 @@ template <typename Connector, typename Locker, typename Barrier>
 size_t base_safe_connector<Connector, Locker, Barrier>::memory_size(const size_t size) const
 {
     return base_type::memory_size(size) + sizeof(locker_type) +
-        Barrier::barrier_size() + sizeof(spinlock) + sizeof(uint32_t);
+        2 * Barrier::barrier_size() + notifier::table_size() + sizeof(uint32_t) +
+        sizeof(spinlock) + sizeof(uint32_t);
 }
 
 /**
@@ -812,9 +1258,20 @@ bool base_safe_connector<Connector, Locker, Barrier>::do_push(const tag_type tag
     const void *data, const size_t size)
 {
     lock_to_push_type lock(*m_plocker);
-    if (lock.owns() && base_type::do_push(tag, data, size))
+    if (lock.owns())
     {
-        return true;
+        recover();
+        bool pushed = false;
+        {
+            sequence_guard guard(*m_psequence);
+            pushed = base_type::do_push(tag, data, size);
+        }
+        if (pushed)
+        {
+            lock.unlock();
+            notify();
+            return true;
+        }
     }
     return false;
 }
@@ -827,10 +1284,22 @@ bool base_safe_connector<Connector, Locker, Barrier>::do_push(const tag_type tag
 template <typename Connector, typename Locker, typename Barrier>
 const pmessage_type base_safe_connector<Connector, Locker, Barrier>::do_get() const
 {
+    if (optimistic_empty() && !m_notifier.acknowledge())
+    {
+        return pmessage_type();
+    }
     lock_to_get_type lock(*m_plocker);
     if (lock.owns())
     {
-        return base_type::do_get();
+        recover();
+        pmessage_type pmessage = base_type::do_get();
+        if (!pmessage && m_notifier.acknowledge())
+        {
+            /* the messages pushed before the acknowledgement are not
+             * signalled, so the connector must be checked again */
+            pmessage = base_type::do_get();
+        }
+        return pmessage;
     }
     return pmessage_type();
 }
@@ -844,13 +1313,134 @@ template <typename Connector, typename Locker, typename Barrier>
 bool base_safe_connector<Connector, Locker, Barrier>::do_pop()
 {
     lock_to_pop_type lock(*m_plocker);
-    if (lock.owns() && base_type::do_pop())
+    if (lock.owns())
     {
-        return true;
+        recover();
+        sequence_guard guard(*m_psequence);
+        return base_type::do_pop();
     }
     return false;
 }
 
+/**
+ * Return the memory pages of free regions to the OS
+ * @return the size of the returned memory
+ */
+//virtual
+template <typename Connector, typename Locker, typename Barrier>
+size_t base_safe_connector<Connector, Locker, Barrier>::do_reclaim()
+{
+    scoped_lock_type lock(*m_plocker);
+    return base_type::do_reclaim();
+}
+
+/**
+ * Flush the connector to its backing store
+ * @return the result of the flushing
+ */
+//virtual
+template <typename Connector, typename Locker, typename Barrier>
+bool base_safe_connector<Connector, Locker, Barrier>::do_flush()
+{
+    sharable_lock_type lock(*m_plocker);
+    return base_type::do_flush();
+}
+
+/**
+ * Get the descriptor that becomes readable after pushes
+ * @return the descriptor or -1
+ */
+//virtual
+template <typename Connector, typename Locker, typename Barrier>
+int base_safe_connector<Connector, Locker, Barrier>::do_native_handle() const
+{
+    return m_notifier.native_handle();
+}
+
+/**
+ * Get the sequence of changes of the queue, the writers change it by
+ * sequence_guard while they hold the locker
+ * @return the sequence of changes
+ */
+template <typename Connector, typename Locker, typename Barrier>
+volatile uint32_t& base_safe_connector<Connector, Locker, Barrier>::sequence() const
+{
+    return *m_psequence;
+}
+
+/**
+ * Check without the locker that the connector is empty. The reader takes
+ * a snapshot of the sequence, checks the queue and validates the sequence
+ * again, so polling an empty connector writes nothing to the shared memory.
+ * Writers that pop under a sharable lock change the sequence concurrently,
+ * but they change only their own view of the queue. Producers and consumers
+ * of a dual locker change it concurrently too, but the count of messages
+ * they publish is a single word.
+ * @return false if the connector isn't empty or it is being changed
+ */
+template <typename Connector, typename Locker, typename Barrier>
+bool base_safe_connector<Connector, Locker, Barrier>::optimistic_empty() const
+{
+    using namespace boost::interprocess::ipcdetail;
+    const uint32_t sequence = atomic_read32(m_psequence);
+    if (sequence & 1)
+    {
+        return false;
+    }
+    const bool empty = base_type::empty_queue();
+    return empty && atomic_read32(m_psequence) == sequence;
+}
+
+/**
+ * Repair the connector if the previous owner of the locker died holding it,
+ * it must be called right after the locker is taken. Only robust lockers
+ * report it, the sharable lock of them is exclusive, so the repair can't
+ * race with anybody.
+ */
+template <typename Connector, typename Locker, typename Barrier>
+void base_safe_connector<Connector, Locker, Barrier>::recover() const
+{
+    if (owner_died(*m_plocker))
+    {
+        base_type::repair_queue();
+        *m_psequence = *m_psequence & ~1u;
+        make_consistent(*m_plocker);
+    }
+}
+
+/**
+ * Create the sequence of changes
+ * @param ptr pointer to the place where the sequence will be built
+ * @return pointer to memory region after the sequence
+ */
+template <typename Connector, typename Locker, typename Barrier>
+void *base_safe_connector<Connector, Locker, Barrier>::create_sequence(void *ptr)
+{
+    m_psequence = new (ptr) uint32_t(0);
+    return reinterpret_cast<uint8_t*>(ptr) + sizeof(uint32_t);
+}
+
+/**
+ * Open the sequence of changes
+ * @param ptr pointer to the place where the sequence is located
+ * @return pointer to memory region after the sequence
+ */
+template <typename Connector, typename Locker, typename Barrier>
+void *base_safe_connector<Connector, Locker, Barrier>::open_sequence(void *ptr)
+{
+    m_psequence = reinterpret_cast<volatile uint32_t*>(ptr);
+    return reinterpret_cast<uint8_t*>(ptr) + sizeof(uint32_t);
+}
+
+/**
+ * Signal the subscribers of the native handle
+ */
+template <typename Connector, typename Locker, typename Barrier>
+void base_safe_connector<Connector, Locker, Barrier>::notify()
+{
+    m_notifier.notify();
+}
+
 /**
  * Get the locker
  * @return the locker
@@ -862,15 +1452,100 @@ typename base_safe_connector<Connector, Locker, Barrier>::locker_type&
     return *m_plocker;
 }
 
+/**
+ * Get the barrier of free space, a producer that finds the queue full
+ * knocks on it under the lock to push, a pop opens it under the lock to pop
+ * @return the barrier of free space
+ */
+template <typename Connector, typename Locker, typename Barrier>
+const Barrier& base_safe_connector<Connector, Locker, Barrier>::space_barrier() const
+{
+    return m_space_barrier;
+}
+
 //==============================================================================
 //  safe_connector
 //==============================================================================
+/**
+ * Push data to the connector
+ * @param tag the tag of the data
+ * @param data the data
+ * @param size the size of the data
+ * @param timeout the allowable timeout of the pushing
+ * @return result of the pushing
+ */
+//virtual
+template <typename Connector, typename Locker, typename WaitStrategy, bool B>
+bool safe_connector<Connector, Locker, WaitStrategy, B>::do_timed_push(const tag_type tag,
+    const void *data, const size_t size, const struct timespec& timeout)
+{
+    const struct timespec ts = get_monotonic_time() + timeout;
+    WaitStrategy strategy;
+    while (get_monotonic_time() < ts)
+    {
+        if (base_type::do_push(tag, data, size))
+        {
+            return true;
+        }
+        strategy.idle();
+    }
+    return false;
+}
+
+/**
+ * Get the next message from the connector
+ * @param timeout the allowable timeout of the getting
+ * @return the message
+ */
+//virtual
+template <typename Connector, typename Locker, typename WaitStrategy, bool B>
+const pmessage_type safe_connector<Connector, Locker, WaitStrategy, B>::
+    do_timed_get(const struct timespec& timeout) const
+{
+    const struct timespec ts = get_monotonic_time() + timeout;
+    pmessage_type pmessage;
+    WaitStrategy strategy;
+    while (get_monotonic_time() < ts)
+    {
+        pmessage = base_type::do_get();
+        if (pmessage)
+        {
+            return pmessage;
+        }
+        strategy.idle();
+    }
+    return pmessage;
+}
+
+/**
+ * Remove the next message from the connector
+ * @param timeout the allowable timeout of the removing
+ * @return the result of the removing
+ */
+//virtual
+template <typename Connector, typename Locker, typename WaitStrategy, bool B>
+bool safe_connector<Connector, Locker, WaitStrategy, B>::
+    do_timed_pop(const struct timespec& timeout)
+{
+    const struct timespec ts = get_monotonic_time() + timeout;
+    WaitStrategy strategy;
+    while (get_monotonic_time() < ts)
+    {
+        if (base_type::do_pop())
+        {
+            return true;
+        }
+        strategy.idle();
+    }
+    return false;
+}
+
 /**
  * Constructor
  * @param name the name of the connector
  */
-template <typename Connector, typename Locker>
-safe_connector<Connector, Locker, true>::safe_connector(const std::string& name) :
+template <typename Connector, typename Locker, typename WaitStrategy>
+safe_connector<Connector, Locker, WaitStrategy, true>::safe_connector(const std::string& name) :
     base_type(name)
 {
 }
@@ -883,15 +1558,26 @@ safe_connector<Connector, Locker, true>::safe_connector(const std::string& name)
  * @return result of the pushing
  */
 //virtual
-template <typename Connector, typename Locker>
-bool safe_connector<Connector, Locker, true>::do_push(const tag_type tag, 
+template <typename Connector, typename Locker, typename WaitStrategy>
+bool safe_connector<Connector, Locker, WaitStrategy, true>::do_push(const tag_type tag, 
     const void *data, const size_t size)
 {
     lock_to_push_type lock(base_type::locker());
-    if (lock.owns() && base_type::do_push(tag, data, size))
+    if (lock.owns())
     {
-        base_type::barrier().open();
-        return true;
+        base_type::recover();
+        bool pushed = false;
+        {
+            sequence_guard guard(base_type::sequence());
+            pushed = connector_type::do_push(tag, data, size);
+        }
+        if (pushed)
+        {
+            base_type::barrier().open();
+            lock.unlock();
+            base_type::notify();
+            return true;
+        }
     }
     return false;
 }
@@ -905,17 +1591,69 @@ bool safe_connector<Connector, Locker, true>::do_push(const tag_type tag,
  * @return result of the pushing
  */
 //virtual
-template <typename Connector, typename Locker>
-bool safe_connector<Connector, Locker, true>::do_timed_push(const tag_type tag, 
+template <typename Connector, typename Locker, typename WaitStrategy>
+bool safe_connector<Connector, Locker, WaitStrategy, true>::do_timed_push(const tag_type tag, 
     const void *data, const size_t size, const struct timespec& timeout)
 {
     const struct timespec ts = get_monotonic_time() + timeout;
+    WaitStrategy strategy;
     while (get_monotonic_time() < ts)
     {
         lock_to_push_type lock(base_type::locker(), ts - get_monotonic_time());
-        if (lock.owns() && connector_type::do_push(tag, data, size))
+        if (lock.owns())
         {
-            base_type::barrier().open();
+            base_type::recover();
+            bool pushed = false;
+            {
+                sequence_guard guard(base_type::sequence());
+                pushed = connector_type::do_push(tag, data, size);
+            }
+            if (pushed)
+            {
+                base_type::barrier().open();
+                lock.unlock();
+                base_type::notify();
+                return true;
+            }
+            if (!strategy.parking())
+            {
+                lock.unlock();
+                strategy.idle();
+                continue;
+            }
+            /* the queue is full, the producer sleeps until a pop frees
+             * some space instead of polling it */
+            base_type::space_barrier().barrier().knock();
+            lock.unlock();
+            if (!base_type::space_barrier().barrier().expect(ts - get_monotonic_time()))
+            {
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Remove the next message from the connector
+ * @return the result of the removing
+ */
+//virtual
+template <typename Connector, typename Locker, typename WaitStrategy>
+bool safe_connector<Connector, Locker, WaitStrategy, true>::do_pop()
+{
+    lock_to_pop_type lock(base_type::locker());
+    if (lock.owns())
+    {
+        base_type::recover();
+        bool popped = false;
+        {
+            sequence_guard guard(base_type::sequence());
+            popped = connector_type::do_pop();
+        }
+        if (popped)
+        {
+            base_type::space_barrier().barrier().open();
             return true;
         }
     }
@@ -928,22 +1666,35 @@ bool safe_connector<Connector, Locker, true>::do_timed_push(const tag_type tag,
  * @return the message
  */
 //virtual
-template <typename Connector, typename Locker>
-const pmessage_type safe_connector<Connector, Locker, true>::
+template <typename Connector, typename Locker, typename WaitStrategy>
+const pmessage_type safe_connector<Connector, Locker, WaitStrategy, true>::
     do_timed_get(const struct timespec& timeout) const
 {
     const struct timespec ts = get_monotonic_time() + timeout;
     pmessage_type pmessage;
+    WaitStrategy strategy;
     while (get_monotonic_time() < ts)
     {
+        if (!strategy.parking() && base_type::optimistic_empty())
+        {
+            strategy.idle();
+            continue;
+        }
         lock_to_get_type lock(base_type::locker(), ts - get_monotonic_time());
         if (lock.owns())
         {
+            base_type::recover();
             pmessage = connector_type::do_get();
             if (pmessage)
             {
                 return pmessage;
             }
+            if (!strategy.parking())
+            {
+                lock.unlock();
+                strategy.idle();
+                continue;
+            }
             base_type::barrier().knock();
             lock.unlock();
             if (!base_type::barrier().expect(ts - get_monotonic_time()))
@@ -961,17 +1712,30 @@ const pmessage_type safe_connector<Connector, Locker, true>::
  * @return the result of the removing
  */
 //virtual
-template <typename Connector, typename Locker>
-bool safe_connector<Connector, Locker, true>::
+template <typename Connector, typename Locker, typename WaitStrategy>
+bool safe_connector<Connector, Locker, WaitStrategy, true>::
     do_timed_pop(const struct timespec& timeout)
 {
     const struct timespec ts = get_monotonic_time() + timeout;
+    WaitStrategy strategy;
     while (get_monotonic_time() < ts)
     {
         lock_to_pop_type lock(base_type::locker(), ts - get_monotonic_time());
-        if (lock.owns() && connector_type::do_pop())
+        if (lock.owns())
         {
-            return true;
+            base_type::recover();
+            bool popped = false;
+            {
+                sequence_guard guard(base_type::sequence());
+                popped = connector_type::do_pop();
+            }
+            if (popped)
+            {
+                base_type::space_barrier().barrier().open();
+                return true;
+            }
+            lock.unlock();
+            strategy.idle();
         }
     }
     return false;
@@ -997,6 +1761,15 @@ typedef connector::safe_connector<
 typedef connector::safe_connector<
     connector::bidirectional_connector<connector::multi_bidirectional_connector_type>,
     connector::sharable_spinlocker_with_sharable_pop_interface> multi_bidirectional_connector_type;
+typedef connector::safe_connector<
+    connector::input_connector<
+        connector::persistent_single_bidirectional_connector_type> > persistent_single_input_connector_type;
+typedef connector::safe_connector<
+    connector::output_connector<
+        connector::persistent_single_bidirectional_connector_type> > persistent_single_output_connector_type;
+typedef connector::safe_connector<
+    connector::bidirectional_connector<
+        connector::persistent_single_bidirectional_connector_type> > persistent_single_bidirectional_connector_type;
 
 typedef connector::pconnector_type pconnector_type;
 
@@ -0,0 +1,448 @@
+#include "qbus/journal.h"
+#include "qbus/common.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+namespace qbus
+{
+
+namespace journal
+{
+
+/**
+ * Write the IO vector to the file completely
+ * @param fd the descriptor of the file
+ * @param iov the IO vector, it's changed by the writing
+ * @param count the count of entries of the IO vector
+ * @return the result of the writing
+ */
+static bool write_vector(const int fd, struct iovec *iov, int count)
+{
+    while (count > 0)
+    {
+        ssize_t size = writev(fd, iov, std::min(count, IOV_MAX));
+        if (size < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return false;
+        }
+        while (count > 0 && static_cast<size_t>(size) >= iov->iov_len)
+        {
+            size -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = reinterpret_cast<uint8_t*>(iov->iov_base) + size;
+            iov->iov_len -= size;
+        }
+    }
+    return true;
+}
+
+/**
+ * Write the data to the file at the offset completely
+ * @param fd the descriptor of the file
+ * @param data the data
+ * @param size the size of the data
+ * @param offset the offset in the file
+ * @return the result of the writing
+ */
+static bool write_at(const int fd, const void *data, size_t size, off_t offset)
+{
+    const uint8_t *ptr = reinterpret_cast<const uint8_t*>(data);
+    while (size > 0)
+    {
+        const ssize_t result = pwrite(fd, ptr, size, offset);
+        if (result < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return false;
+        }
+        ptr += result;
+        size -= result;
+        offset += result;
+    }
+    return true;
+}
+
+/**
+ * Get the name of a segment file
+ * @param path the path of the journal
+ * @param number the number of the segment
+ * @return the name of the segment file
+ */
+std::string segment_name(const std::string& path, const uint32_t number)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%08u", number);
+    return path + suffix;
+}
+
+//==============================================================================
+//  writer
+//==============================================================================
+/**
+ * Constructor
+ * @param pbus the bus that is tailed, it must be opened as a subscriber
+ * @param path the path of the journal, segment files get a number suffix
+ * @param segment_size the size after which the next segment is started
+ */
+writer::writer(const pbus_type& pbus, const std::string& path, const size_t segment_size) :
+    m_pbus(pbus),
+    m_path(path),
+    m_segment_size(segment_size),
+    m_fd(-1),
+    m_segment(0),
+    m_offset(0),
+    m_seq(0)
+{
+    memset(&m_header, 0, sizeof(m_header));
+}
+
+/**
+ * Destructor
+ */
+writer::~writer()
+{
+    close();
+}
+
+/**
+ * Move all available messages from the bus to the journal. The writer only
+ * reads its own subscription, so the producers never wait for the disk.
+ * @return the count of journaled messages
+ */
+size_t writer::poll()
+{
+    size_t result = 0;
+    if (m_fd < 0 && !open_segment())
+    {
+        return result;
+    }
+    pmessage_type pmessage = m_pbus->get();
+    while (pmessage && append(pmessage))
+    {
+        m_pbus->pop();
+        ++result;
+        pmessage = m_pbus->get();
+    }
+    flush();
+    return result;
+}
+
+/**
+ * Get the count of journaled messages
+ * @return the count of journaled messages
+ */
+seq_type writer::count() const
+{
+    return m_seq;
+}
+
+/**
+ * Get the size of batched records
+ * @return the size of batched records
+ */
+size_t writer::batch_size() const
+{
+    return m_records.size() * sizeof(record_header_type) + m_data.size();
+}
+
+/**
+ * Add the message to the batch
+ * @param pmessage the message
+ * @return the result of the adding
+ */
+bool writer::append(const pmessage_type& pmessage)
+{
+    const size_t size = pmessage->data_size();
+    if (m_records.size() + m_index.size() > 0 &&
+        m_offset + batch_size() + sizeof(record_header_type) + size > m_segment_size)
+    {
+        if (!flush() || !seal_segment() || !open_segment())
+        {
+            return false;
+        }
+    }
+    else if (MAX_BATCH_RECORDS == m_records.size() && !flush())
+    {
+        return false;
+    }
+    record_header_type record;
+    record.size = size;
+    record.tag = pmessage->tag();
+    record.sid = pmessage->sid();
+    record.timestamp = pmessage->timestamp();
+    m_records.push_back(record);
+    const size_t pos = m_data.size();
+    m_data.resize(pos + size);
+    if (size > 0)
+    {
+        pmessage->unpack(&m_data[pos]);
+    }
+    ++m_seq;
+    return true;
+}
+
+/**
+ * Write the batched records to the current segment
+ * @return the result of the writing
+ */
+bool writer::flush()
+{
+    if (m_records.empty())
+    {
+        return true;
+    }
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    std::vector<struct iovec> iov(m_records.size() * 2);
+    uint8_t *ptr = m_data.empty() ? NULL : &m_data[0];
+    uint32_t offset = m_offset;
+    for (size_t i = 0; i < m_records.size(); ++i)
+    {
+        iov[2 * i].iov_base = &m_records[i];
+        iov[2 * i].iov_len = sizeof(record_header_type);
+        iov[2 * i + 1].iov_base = ptr;
+        iov[2 * i + 1].iov_len = m_records[i].size;
+        ptr += m_records[i].size;
+        m_index.push_back(offset);
+        offset += sizeof(record_header_type) + m_records[i].size;
+    }
+    if (write_vector(m_fd, &iov[0], iov.size()))
+    {
+        m_records.clear();
+        m_data.clear();
+        m_offset = offset;
+        return true;
+    }
+    m_index.resize(m_index.size() - m_records.size());
+    return false;
+}
+
+/**
+ * Seal the current segment
+ * @return the result of the sealing
+ */
+bool writer::close()
+{
+    return m_fd < 0 || (flush() && seal_segment());
+}
+
+/**
+ * Open the next segment
+ * @return the result of the opening
+ */
+bool writer::open_segment()
+{
+    const std::string name = segment_name(m_path, m_segment);
+    m_fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    ++m_segment;
+    m_header.magic = JOURNAL_MAGIC;
+    m_header.version = JOURNAL_VERSION;
+    m_header.first_seq = m_seq - m_records.size();
+    m_header.count = 0;
+    m_header.index_offset = 0;
+    m_offset = sizeof(segment_header_type);
+    m_index.clear();
+    return write_at(m_fd, &m_header, sizeof(m_header), 0) &&
+        lseek(m_fd, m_offset, SEEK_SET) == static_cast<off_t>(m_offset);
+}
+
+/**
+ * Write the index and finish the current segment
+ * @return the result of the sealing
+ */
+bool writer::seal_segment()
+{
+    bool result = m_index.empty() ||
+        write_at(m_fd, &m_index[0], m_index.size() * sizeof(uint32_t), m_offset);
+    if (result)
+    {
+        m_header.count = m_index.size();
+        m_header.index_offset = m_offset;
+        result = write_at(m_fd, &m_header, sizeof(m_header), 0) && 0 == fdatasync(m_fd);
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    return result;
+}
+
+//==============================================================================
+//  replayer
+//==============================================================================
+/**
+ * Constructor
+ * @param path the path of the journal
+ */
+replayer::replayer(const std::string& path) :
+    m_path(path)
+{
+}
+
+/**
+ * Push the journal into the bus
+ * @param bus the bus
+ * @param mode the mode of the replaying
+ * @param from the sequence number of the first replayed record
+ * @return the count of pushed messages
+ */
+size_t replayer::replay(bus::base_bus& bus, const replay_mode mode, const seq_type from) const
+{
+    size_t result = 0;
+    struct timespec start = { 0, 0 };
+    uint32_t first_timestamp = 0;
+    buffer_type buffer;
+    std::vector<uint32_t> index;
+    for (uint32_t number = 0; load_segment(segment_name(m_path, number), buffer) &&
+        make_index(buffer, index); ++number)
+    {
+        segment_header_type header;
+        memcpy(&header, &buffer[0], sizeof(header));
+        if (header.first_seq + index.size() <= from)
+        {
+            continue;
+        }
+        for (size_t i = from > header.first_seq ? from - header.first_seq : 0;
+            i < index.size(); ++i)
+        {
+            record_header_type record;
+            memcpy(&record, &buffer[index[i]], sizeof(record));
+            if (RM_ORIGINAL == mode)
+            {
+                if (0 == result)
+                {
+                    start = get_monotonic_time();
+                    first_timestamp = record.timestamp;
+                }
+                else if (record.timestamp > first_timestamp)
+                {
+                    struct timespec delay = { 0, 0 };
+                    delay.tv_sec = record.timestamp - first_timestamp;
+                    const struct timespec finish = start + delay;
+                    const struct timespec now = get_monotonic_time();
+                    if (finish > now)
+                    {
+                        const struct timespec rest = finish - now;
+                        nanosleep(&rest, NULL);
+                    }
+                }
+            }
+            if (!bus.push(record.tag, &buffer[index[i] + sizeof(record)], record.size))
+            {
+                return result;
+            }
+            ++result;
+        }
+    }
+    return result;
+}
+
+/**
+ * Read the whole segment
+ * @param name the name of the segment file
+ * @param buffer the buffer for the segment
+ * @return the result of the reading
+ */
+//static
+bool replayer::load_segment(const std::string& name, buffer_type& buffer)
+{
+    const int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    bool result = 0 == fstat(fd, &st) &&
+        static_cast<size_t>(st.st_size) >= sizeof(segment_header_type);
+    if (result)
+    {
+        buffer.resize(st.st_size);
+        size_t size = 0;
+        while (size < buffer.size())
+        {
+            const ssize_t count = read(fd, &buffer[size], buffer.size() - size);
+            if (count < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                result = false;
+                break;
+            }
+            size += count;
+        }
+    }
+    ::close(fd);
+    return result;
+}
+
+/**
+ * Get the offsets of records of the segment, a segment that wasn't sealed is
+ * scanned up to the last complete record
+ * @param buffer the segment
+ * @param index the offsets of records
+ * @return the result of the getting
+ */
+//static
+bool replayer::make_index(const buffer_type& buffer, std::vector<uint32_t>& index)
+{
+    segment_header_type header;
+    memcpy(&header, &buffer[0], sizeof(header));
+    if (header.magic != JOURNAL_MAGIC || header.version != JOURNAL_VERSION)
+    {
+        return false;
+    }
+    index.clear();
+    if (header.index_offset > 0)
+    {
+        if (header.index_offset + header.count * sizeof(uint32_t) > buffer.size())
+        {
+            return false;
+        }
+        index.resize(header.count);
+        if (header.count > 0)
+        {
+            memcpy(&index[0], &buffer[header.index_offset], header.count * sizeof(uint32_t));
+        }
+        return true;
+    }
+    size_t offset = sizeof(segment_header_type);
+    while (offset + sizeof(record_header_type) <= buffer.size())
+    {
+        record_header_type record;
+        memcpy(&record, &buffer[offset], sizeof(record));
+        if (offset + sizeof(record) + record.size > buffer.size())
+        {
+            break;
+        }
+        index.push_back(offset);
+        offset += sizeof(record) + record.size;
+    }
+    return true;
+}
+
+} //namespace journal
+
+} //namespace qbus
@@ -0,0 +1,115 @@
+#ifndef QBUS_JOURNAL_H
+#define QBUS_JOURNAL_H
+
+#include "qbus/bus.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace qbus
+{
+
+namespace journal
+{
+
+typedef bus::tag_type tag_type;
+typedef uint64_t seq_type;
+
+enum
+{
+    JOURNAL_MAGIC   = 0x4c4e524a, ///< "JRNL"
+    JOURNAL_VERSION = 1
+};
+
+/**
+ * The header of a segment file
+ */
+struct segment_header_type
+{
+    uint32_t magic; ///< the magic number of the journal
+    uint32_t version; ///< the version of the format
+    seq_type first_seq; ///< the sequence number of the first record
+    uint32_t count; ///< the count of records, it's set when the segment is sealed
+    uint32_t index_offset; ///< the offset of the index, 0 if the segment isn't sealed
+};
+
+/**
+ * The header of a record, the data of the message follows it
+ */
+struct record_header_type
+{
+    uint32_t size; ///< the size of the data
+    tag_type tag; ///< the tag of the message
+    uint32_t sid; ///< the source identifier of the message
+    uint32_t timestamp; ///< the timestamp of the message
+};
+
+enum replay_mode
+{
+    RM_FAST,        ///< push the records as fast as possible
+    RM_ORIGINAL     ///< push the records keeping the original intervals
+};
+
+std::string segment_name(const std::string& path, const uint32_t number); ///< get the name of a segment file
+
+/**
+ * The journal writer, it tails a bus as one more subscriber and appends
+ * everything it gets to segment files
+ */
+class writer
+{
+public:
+    writer(const pbus_type& pbus, const std::string& path,
+        const size_t segment_size = 64 * 1024 * 1024);
+    ~writer();
+    size_t poll(); ///< move all available messages from the bus to the journal
+    bool flush(); ///< write the batched records to the current segment
+    bool close(); ///< seal the current segment
+    seq_type count() const; ///< get the count of journaled messages
+private:
+    writer(const writer&);
+    writer& operator=(const writer&);
+    bool append(const pmessage_type& pmessage); ///< add the message to the batch
+    bool open_segment(); ///< open the next segment
+    bool seal_segment(); ///< write the index and finish the current segment
+    size_t batch_size() const; ///< get the size of batched records
+private:
+    enum
+    {
+        MAX_BATCH_RECORDS = 512 ///< every record takes two entries of the IO vector
+    };
+    const pbus_type m_pbus;
+    const std::string m_path;
+    const size_t m_segment_size;
+    int m_fd; ///< the descriptor of the current segment
+    uint32_t m_segment; ///< the number of the next segment
+    segment_header_type m_header; ///< the header of the current segment
+    uint32_t m_offset; ///< the end of written records in the current segment
+    std::vector<uint32_t> m_index; ///< the offsets of written records
+    std::vector<record_header_type> m_records; ///< the batched record headers
+    std::vector<uint8_t> m_data; ///< the batched record data
+    seq_type m_seq; ///< the sequence number of the next record
+};
+
+/**
+ * The journal replayer, it pushes the journaled messages back into a bus
+ */
+class replayer
+{
+public:
+    explicit replayer(const std::string& path);
+    size_t replay(bus::base_bus& bus, const replay_mode mode = RM_FAST,
+        const seq_type from = 0) const; ///< push the journal into the bus
+private:
+    typedef std::vector<uint8_t> buffer_type;
+    static bool load_segment(const std::string& name, buffer_type& buffer); ///< read the whole segment
+    static bool make_index(const buffer_type& buffer, std::vector<uint32_t>& index); ///< get the offsets of records
+private:
+    const std::string m_path;
+};
+
+} //namespace journal
+
+} //namespace qbus
+
+#endif /* QBUS_JOURNAL_H */
@@ -2,7 +2,11 @@
 #include "qbus/common.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <boost/thread/thread_time.hpp>
 #include <boost/interprocess/detail/atomic.hpp>
 
@@ -300,6 +304,711 @@ void shared_posix_locker::unlock_sharable()
     unlock();
 }
 
+//==============================================================================
+//  shared_robust_locker
+//==============================================================================
+/**
+ * Constructor
+ */
+shared_robust_locker::shared_robust_locker() :
+    m_owner_died(0)
+{
+    pthread_mutexattr_t attr;
+    int result = pthread_mutexattr_init(&attr);
+    assert(0 == result);
+    result = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    assert(0 == result);
+    result = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    assert(0 == result);
+    result = pthread_mutex_init(&m_lock, &attr);
+    assert(0 == result);
+    pthread_mutexattr_destroy(&attr);
+    QBUS_UNUSED(result);
+}
+
+/**
+ * Destructor
+ */
+shared_robust_locker::~shared_robust_locker()
+{
+    pthread_mutex_destroy(&m_lock);
+}
+
+/**
+ * Handle the result of a locking, the mutex whose owner died is made
+ * usable again and the repair of the protected data is requested
+ * @param result the result of a locking
+ * @return true if the locker is owned
+ */
+bool shared_robust_locker::acquired(const int result)
+{
+    if (EOWNERDEAD == result)
+    {
+        pthread_mutex_consistent(&m_lock);
+        m_owner_died = 1;
+        return true;
+    }
+    return 0 == result;
+}
+
+/**
+ * Try to set the exclusive lock
+ * @return the result of the setting
+ */
+bool shared_robust_locker::try_lock()
+{
+    return acquired(pthread_mutex_trylock(&m_lock));
+}
+
+/**
+ * Set the exclusive lock
+ */
+void shared_robust_locker::lock()
+{
+    const bool result = acquired(pthread_mutex_lock(&m_lock));
+    assert(result);
+    QBUS_UNUSED(result);
+}
+
+/**
+ * Try to set the exclusive lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_robust_locker::timed_lock(const struct timespec& timeout)
+{
+    const struct timespec ts = get_monotonic_time() + timeout;
+    return acquired(pthread_mutex_clocklock(&m_lock, CLOCK_MONOTONIC, &ts));
+}
+
+/**
+ * Remove the exclusive lock
+ */
+void shared_robust_locker::unlock()
+{
+    const int result = pthread_mutex_unlock(&m_lock);
+    assert(0 == result);
+    QBUS_UNUSED(result);
+}
+
+/**
+ * Try to set the sharable lock
+ * @return the result of the setting
+ */
+bool shared_robust_locker::try_lock_sharable()
+{
+    return try_lock();
+}
+
+/**
+ * Set the sharable lock
+ */
+void shared_robust_locker::lock_sharable()
+{
+    lock();
+}
+
+/**
+ * Try to set the sharable lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_robust_locker::timed_lock_sharable(const struct timespec& timeout)
+{
+    return timed_lock(timeout);
+}
+
+/**
+ * Remove the sharable lock
+ */
+void shared_robust_locker::unlock_sharable()
+{
+    unlock();
+}
+
+/**
+ * Check if the previous owner died holding the locker
+ * @return the result of the checking
+ */
+bool shared_robust_locker::owner_died() const
+{
+    return m_owner_died != 0;
+}
+
+/**
+ * Mark the protected data as repaired
+ */
+void shared_robust_locker::consistent()
+{
+    m_owner_died = 0;
+}
+
+//==============================================================================
+//  shared_pi_locker
+//==============================================================================
+/**
+ * Constructor
+ */
+shared_pi_locker::shared_pi_locker()
+{
+    pthread_mutexattr_t attr;
+    int result = pthread_mutexattr_init(&attr);
+    assert(0 == result);
+    result = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    assert(0 == result);
+    result = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    assert(0 == result);
+    result = pthread_mutex_init(&m_lock, &attr);
+    assert(0 == result);
+    pthread_mutexattr_destroy(&attr);
+    QBUS_UNUSED(result);
+}
+
+/**
+ * Destructor
+ */
+shared_pi_locker::~shared_pi_locker()
+{
+    pthread_mutex_destroy(&m_lock);
+}
+
+/**
+ * Try to set the exclusive lock
+ * @return the result of the setting
+ */
+bool shared_pi_locker::try_lock()
+{
+    return 0 == pthread_mutex_trylock(&m_lock);
+}
+
+/**
+ * Set the exclusive lock
+ */
+void shared_pi_locker::lock()
+{
+    const int result = pthread_mutex_lock(&m_lock);
+    assert(0 == result);
+    QBUS_UNUSED(result);
+}
+
+/**
+ * Try to set the exclusive lock until the time comes. The deadline is
+ * taken by the realtime clock, because the kernel measures the waiting
+ * on a priority-inheriting futex by it.
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_pi_locker::timed_lock(const struct timespec& timeout)
+{
+    struct timespec ts = {0, 0};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts = ts + timeout;
+    return 0 == pthread_mutex_timedlock(&m_lock, &ts);
+}
+
+/**
+ * Remove the exclusive lock
+ */
+void shared_pi_locker::unlock()
+{
+    const int result = pthread_mutex_unlock(&m_lock);
+    assert(0 == result);
+    QBUS_UNUSED(result);
+}
+
+/**
+ * Try to set the sharable lock
+ * @return the result of the setting
+ */
+bool shared_pi_locker::try_lock_sharable()
+{
+    return try_lock();
+}
+
+/**
+ * Set the sharable lock
+ */
+void shared_pi_locker::lock_sharable()
+{
+    lock();
+}
+
+/**
+ * Try to set the sharable lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_pi_locker::timed_lock_sharable(const struct timespec& timeout)
+{
+    return timed_lock(timeout);
+}
+
+/**
+ * Remove the sharable lock
+ */
+void shared_pi_locker::unlock_sharable()
+{
+    unlock();
+}
+
+//==============================================================================
+//  shared_futex_locker
+//==============================================================================
+/**
+ * Wait on the futex while it has the value, the futex isn't private because
+ * the waiters live in different processes
+ * @param addr the address of the futex
+ * @param value the expected value of the futex
+ * @param timeout the allowable relative timeout of the waiting or NULL
+ */
+static void futex_wait(volatile uint32_t *addr, const uint32_t value,
+    const struct timespec *timeout)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT, value, timeout, NULL, 0);
+}
+
+/**
+ * Wake the waiters of the futex
+ * @param addr the address of the futex
+ * @param count the count of the woken waiters
+ */
+static void futex_wake(volatile uint32_t *addr, const int count)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+/**
+ * Constructor
+ */
+shared_futex_locker::shared_futex_locker() :
+    m_state(0)
+{
+}
+
+/**
+ * Wait while the mask bits of the state are set
+ * @param mask the mask of the state
+ * @param pdeadline the monotonic time of the deadline or NULL
+ * @return false if the deadline came
+ */
+bool shared_futex_locker::wait(const uint32_t mask, const struct timespec *pdeadline)
+{
+    using namespace boost::interprocess::ipcdetail;
+    unsigned int k = 0;
+    while (1)
+    {
+        const uint32_t state = atomic_read32(const_cast<uint32_t*>(&m_state));
+        if (0 == (state & mask))
+        {
+            return true;
+        }
+        if (pdeadline != NULL && get_monotonic_time() >= *pdeadline)
+        {
+            return false;
+        }
+        if (k < SPIN_COUNT)
+        {
+            boost::detail::yield(k++);
+            continue;
+        }
+        if (0 == (state & WAITERS) && 
+            atomic_cas32(const_cast<uint32_t*>(&m_state), state | WAITERS, state) != state)
+        {
+            continue;
+        }
+        if (pdeadline != NULL)
+        {
+            const struct timespec timeout = *pdeadline - get_monotonic_time();
+            futex_wait(&m_state, state | WAITERS, &timeout);
+        }
+        else
+        {
+            futex_wait(&m_state, state | WAITERS, NULL);
+        }
+    }
+}
+
+/**
+ * Wake all the waiters
+ */
+void shared_futex_locker::wake()
+{
+    futex_wake(&m_state, INT_MAX);
+}
+
+/**
+ * Try to set the exclusive lock
+ * @return the result of the setting
+ */
+bool shared_futex_locker::try_lock()
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t state = atomic_read32(const_cast<uint32_t*>(&m_state));
+    while (0 == (state & (WRITER | READERS)))
+    {
+        const uint32_t prev = atomic_cas32(const_cast<uint32_t*>(&m_state), state | WRITER, state);
+        if (prev == state)
+        {
+            return true;
+        }
+        state = prev;
+    }
+    return false;
+}
+
+/**
+ * Set the exclusive lock
+ */
+void shared_futex_locker::lock()
+{
+    while (!try_lock())
+    {
+        wait(WRITER | READERS, NULL);
+    }
+}
+
+/**
+ * Try to set the exclusive lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_futex_locker::timed_lock(const struct timespec& timeout)
+{
+    const struct timespec deadline = get_monotonic_time() + timeout;
+    while (!try_lock())
+    {
+        if (!wait(WRITER | READERS, &deadline))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Remove the exclusive lock
+ */
+void shared_futex_locker::unlock()
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t state = atomic_read32(const_cast<uint32_t*>(&m_state));
+    assert(state & WRITER);
+    while (1)
+    {
+        const uint32_t prev = atomic_cas32(const_cast<uint32_t*>(&m_state), 
+            state & ~(WRITER | WAITERS), state);
+        if (prev == state)
+        {
+            break;
+        }
+        state = prev;
+    }
+    if (state & WAITERS)
+    {
+        wake();
+    }
+}
+
+/**
+ * Try to set the sharable lock
+ * @return the result of the setting
+ */
+bool shared_futex_locker::try_lock_sharable()
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t state = atomic_read32(const_cast<uint32_t*>(&m_state));
+    while (0 == (state & WRITER) && (state & READERS) < READERS)
+    {
+        const uint32_t prev = atomic_cas32(const_cast<uint32_t*>(&m_state), state + 1, state);
+        if (prev == state)
+        {
+            return true;
+        }
+        state = prev;
+    }
+    return false;
+}
+
+/**
+ * Set the sharable lock
+ */
+void shared_futex_locker::lock_sharable()
+{
+    while (!try_lock_sharable())
+    {
+        wait(WRITER, NULL);
+    }
+}
+
+/**
+ * Try to set the sharable lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_futex_locker::timed_lock_sharable(const struct timespec& timeout)
+{
+    const struct timespec deadline = get_monotonic_time() + timeout;
+    while (!try_lock_sharable())
+    {
+        if (!wait(WRITER, &deadline))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Remove the sharable lock
+ */
+void shared_futex_locker::unlock_sharable()
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t state = atomic_read32(const_cast<uint32_t*>(&m_state));
+    assert(state & READERS);
+    uint32_t next = 0;
+    while (1)
+    {
+        next = state - 1;
+        if (0 == (next & READERS))
+        {
+            next &= ~WAITERS;
+        }
+        const uint32_t prev = atomic_cas32(const_cast<uint32_t*>(&m_state), next, state);
+        if (prev == state)
+        {
+            break;
+        }
+        state = prev;
+    }
+    if ((state & WAITERS) && 0 == (next & WAITERS))
+    {
+        wake();
+    }
+}
+
+//==============================================================================
+//  shared_fair_locker
+//==============================================================================
+/**
+ * Constructor
+ */
+shared_fair_locker::shared_fair_locker() :
+    m_rin(0),
+    m_rout(0),
+    m_win(0),
+    m_wout(0)
+{
+}
+
+/**
+ * Block new readers and wait for the readers that entered before
+ * @param ticket the ticket of the writer
+ * @param pdeadline the monotonic time of the deadline or NULL
+ * @return false if the deadline came, the write phase is finished then
+ */
+bool shared_fair_locker::lock_readers(const uint32_t ticket, const struct timespec *pdeadline)
+{
+    using namespace boost::interprocess::ipcdetail;
+    const uint32_t readers = atomic_add32(&m_rin, PRESENT | (ticket & PHASE)) & ~WRITER_BITS;
+    unsigned int k = 0;
+    while (atomic_read32(&m_rout) != readers)
+    {
+        if (pdeadline != NULL && get_monotonic_time() >= *pdeadline)
+        {
+            leave();
+            return false;
+        }
+        boost::detail::yield(k++);
+    }
+    return true;
+}
+
+/**
+ * Finish the write phase, the waiting readers enter and the next writer
+ * is served
+ */
+void shared_fair_locker::leave()
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t rin = atomic_read32(&m_rin);
+    while (1)
+    {
+        const uint32_t prev = atomic_cas32(&m_rin, rin & ~WRITER_BITS, rin);
+        if (prev == rin)
+        {
+            break;
+        }
+        rin = prev;
+    }
+    atomic_inc32(&m_wout);
+}
+
+/**
+ * Wait while the write phase lasts
+ * @param phase the writer bits seen by the reader
+ * @param pdeadline the monotonic time of the deadline or NULL
+ * @return false if the deadline came
+ */
+bool shared_fair_locker::wait_phase(const uint32_t phase, const struct timespec *pdeadline)
+{
+    using namespace boost::interprocess::ipcdetail;
+    unsigned int k = 0;
+    while (phase != 0 && phase == (atomic_read32(&m_rin) & WRITER_BITS))
+    {
+        if (pdeadline != NULL && get_monotonic_time() >= *pdeadline)
+        {
+            return false;
+        }
+        boost::detail::yield(k++);
+    }
+    return true;
+}
+
+/**
+ * Withdraw the reader that arrived during the write phase. The writer
+ * waits for the exact count of readers that entered before it, so the
+ * reader isn't counted as left, it's removed from the entered ones while
+ * the phase lasts. After the phase the next writer may count it already,
+ * then it leaves as usual. The next writer has the other phase bit, and it
+ * can't finish before this reader leaves, so the phase can't come back.
+ * @param phase the writer bits seen by the reader
+ */
+void shared_fair_locker::cancel_reader(const uint32_t phase)
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t rin = atomic_read32(&m_rin);
+    while ((rin & WRITER_BITS) == phase)
+    {
+        const uint32_t prev = atomic_cas32(&m_rin, rin - READER, rin);
+        if (prev == rin)
+        {
+            return;
+        }
+        rin = prev;
+    }
+    atomic_add32(&m_rout, READER);
+}
+
+/**
+ * Try to set the exclusive lock
+ * @return the result of the setting
+ */
+bool shared_fair_locker::try_lock()
+{
+    using namespace boost::interprocess::ipcdetail;
+    const uint32_t ticket = atomic_read32(&m_wout);
+    if (atomic_read32(&m_win) != ticket ||
+        atomic_read32(&m_rin) != atomic_read32(&m_rout) ||
+        atomic_cas32(&m_win, ticket + 1, ticket) != ticket)
+    {
+        return false;
+    }
+    const uint32_t readers = atomic_add32(&m_rin, PRESENT | (ticket & PHASE)) & ~WRITER_BITS;
+    if (atomic_read32(&m_rout) != readers)
+    {
+        leave();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Set the exclusive lock
+ */
+void shared_fair_locker::lock()
+{
+    using namespace boost::interprocess::ipcdetail;
+    const uint32_t ticket = atomic_inc32(&m_win);
+    unsigned int k = 0;
+    while (atomic_read32(&m_wout) != ticket)
+    {
+        boost::detail::yield(k++);
+    }
+    lock_readers(ticket, NULL);
+}
+
+/**
+ * Try to set the exclusive lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_fair_locker::timed_lock(const struct timespec& timeout)
+{
+    using namespace boost::interprocess::ipcdetail;
+    const struct timespec deadline = get_monotonic_time() + timeout;
+    const uint32_t ticket = atomic_inc32(&m_win);
+    unsigned int k = 0;
+    while (atomic_read32(&m_wout) != ticket)
+    {
+        boost::detail::yield(k++);
+    }
+    return lock_readers(ticket, &deadline);
+}
+
+/**
+ * Remove the exclusive lock
+ */
+void shared_fair_locker::unlock()
+{
+    leave();
+}
+
+/**
+ * Try to set the sharable lock
+ * @return the result of the setting
+ */
+bool shared_fair_locker::try_lock_sharable()
+{
+    using namespace boost::interprocess::ipcdetail;
+    if (atomic_read32(&m_rin) & WRITER_BITS)
+    {
+        return false;
+    }
+    const uint32_t phase = atomic_add32(&m_rin, READER) & WRITER_BITS;
+    if (phase != 0)
+    {
+        cancel_reader(phase);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Set the sharable lock
+ */
+void shared_fair_locker::lock_sharable()
+{
+    using namespace boost::interprocess::ipcdetail;
+    wait_phase(atomic_add32(&m_rin, READER) & WRITER_BITS, NULL);
+}
+
+/**
+ * Try to set the sharable lock until the time comes
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+bool shared_fair_locker::timed_lock_sharable(const struct timespec& timeout)
+{
+    using namespace boost::interprocess::ipcdetail;
+    const struct timespec deadline = get_monotonic_time() + timeout;
+    const uint32_t phase = atomic_add32(&m_rin, READER) & WRITER_BITS;
+    if (!wait_phase(phase, &deadline))
+    {
+        cancel_reader(phase);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Remove the sharable lock
+ */
+void shared_fair_locker::unlock_sharable()
+{
+    boost::interprocess::ipcdetail::atomic_add32(&m_rout, READER);
+}
+
 //==============================================================================
 //  shared_barrier
 //==============================================================================
@@ -318,6 +1027,12 @@ shared_barrier::shared_barrier() :
  */
 void shared_barrier::open()
 {
+    /* the knocking and the opening are serialized by the locker of the
+     * owner, so nobody can be knocking right now */
+    if (0 == m_counter1)
+    {
+        return;
+    }
     scoped_lock<locker_type> lock(m_locker);
     while (m_counter1 > 0)
     {
@@ -396,6 +1111,141 @@ bool shared_barrier::expect(const struct timespec& timeout) const
     return true;
 }
 
+//==============================================================================
+//  shared_futex_barrier
+//==============================================================================
+/**
+ * Constructor
+ */
+shared_futex_barrier::shared_futex_barrier() :
+    m_waiters(0),
+    m_wakeups(0)
+{
+}
+
+/**
+ * Open the barrier
+ */
+void shared_futex_barrier::open()
+{
+    using namespace boost::interprocess::ipcdetail;
+    if (0 == m_waiters)
+    {
+        return;
+    }
+    uint32_t waiters = atomic_read32(&m_waiters);
+    while (waiters > 0)
+    {
+        const uint32_t prev = atomic_cas32(&m_waiters, 0, waiters);
+        if (prev == waiters)
+        {
+            atomic_add32(&m_wakeups, waiters);
+            futex_wake(&m_wakeups, waiters);
+            break;
+        }
+        waiters = prev;
+    }
+}
+
+/**
+ * Knock on the barrier
+ */
+void shared_futex_barrier::knock() const
+{
+    /* the posted wakeups belong to the threads that knocked before the
+     * barrier opened, so the latecomer must not steal them */
+    while (m_wakeups > 0)
+    {
+        sched_yield();
+    }
+    boost::interprocess::ipcdetail::atomic_inc32(&m_waiters);
+}
+
+/**
+ * Wait until barrier opens
+ */
+void shared_futex_barrier::wait() const
+{
+    knock();
+    expect();
+}
+
+/**
+ * Wait until barrier opens
+ * @param the allowable timeout of the waiting
+ * @return the result of the waiting
+ */
+bool shared_futex_barrier::wait(const struct timespec& timeout) const
+{
+    knock();
+    return expect(timeout);
+}
+
+/**
+ * Take one of the posted wakeups
+ * @return false if there is no posted wakeup
+ */
+bool shared_futex_barrier::take() const
+{
+    using namespace boost::interprocess::ipcdetail;
+    uint32_t wakeups = atomic_read32(&m_wakeups);
+    while (wakeups > 0)
+    {
+        const uint32_t prev = atomic_cas32(&m_wakeups, wakeups - 1, wakeups);
+        if (prev == wakeups)
+        {
+            return true;
+        }
+        wakeups = prev;
+    }
+    return false;
+}
+
+/**
+ * Expect the barrier to open
+ */
+void shared_futex_barrier::expect() const
+{
+    while (!take())
+    {
+        futex_wait(&m_wakeups, 0, NULL);
+    }
+}
+
+/**
+ * Expect the barrier to open
+ * @param the allowable timeout of the waiting
+ * @return the result of the waiting
+ */
+bool shared_futex_barrier::expect(const struct timespec& timeout) const
+{
+    using namespace boost::interprocess::ipcdetail;
+    const struct timespec deadline = get_monotonic_time() + timeout;
+    while (!take())
+    {
+        const struct timespec now = get_monotonic_time();
+        if (now >= deadline)
+        {
+            uint32_t waiters = atomic_read32(&m_waiters);
+            while (waiters > 0)
+            {
+                const uint32_t prev = atomic_cas32(&m_waiters, waiters - 1, waiters);
+                if (prev == waiters)
+                {
+                    return false;
+                }
+                waiters = prev;
+            }
+            //the barrier has been opened for us, the wakeup is on its way
+            expect();
+            return true;
+        }
+        const struct timespec rest = deadline - now;
+        futex_wait(&m_wakeups, 0, &rest);
+    }
+    return true;
+}
+
 //==============================================================================
 //  spinlock
 //==============================================================================
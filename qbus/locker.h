@@ -4,6 +4,7 @@
 #include "qbus/exceptions.h"
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
 #include <boost/smart_ptr/detail/spinlock.hpp>
 #include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/sync/interprocess_semaphore.hpp>
@@ -71,6 +72,164 @@ private:
     pthread_rwlockattr_t m_lock_attr;
 };
 
+/**
+ * Simple class for robust locker based on pthread_mutex_t, when its owner
+ * dies holding it the next owner gets it with the owner_died() flag set,
+ * repairs the protected data and calls consistent(). The sharable lock is
+ * exclusive, because POSIX has no robust RW lock.
+ */
+class shared_robust_locker
+{
+public:
+    shared_robust_locker();
+    ~shared_robust_locker();
+    void lock();
+    bool timed_lock(const struct timespec& timeout);
+    bool try_lock();
+    void unlock();
+    void lock_sharable();
+    bool timed_lock_sharable(const struct timespec& timeout);
+    bool try_lock_sharable();
+    void unlock_sharable();
+    bool owner_died() const; ///< check if the previous owner died holding the locker
+    void consistent(); ///< mark the protected data as repaired
+private:
+    shared_robust_locker(const shared_robust_locker& );
+    shared_robust_locker& operator=(const shared_robust_locker& );
+    bool acquired(const int result); ///< handle the result of a locking
+private:
+    pthread_mutex_t m_lock;
+    volatile uint32_t m_owner_died;
+};
+
+/**
+ * Check if the previous owner of the locker died holding it, only robust
+ * lockers can tell it
+ * @return the result of the checking
+ */
+template <typename Locker>
+inline bool owner_died(const Locker& )
+{
+    return false;
+}
+
+inline bool owner_died(const shared_robust_locker& locker)
+{
+    return locker.owner_died();
+}
+
+/**
+ * Mark the data protected by the locker as repaired
+ */
+template <typename Locker>
+inline void make_consistent(Locker& )
+{
+}
+
+inline void make_consistent(shared_robust_locker& locker)
+{
+    locker.consistent();
+}
+
+/**
+ * Simple class for priority-inheriting locker based on pthread_mutex_t, a
+ * real-time waiter lends its priority to the owner of the locker, so
+ * a preempted low priority owner can't block it for long. The sharable lock
+ * is exclusive, because POSIX has no priority-inheriting RW lock.
+ */
+class shared_pi_locker
+{
+public:
+    shared_pi_locker();
+    ~shared_pi_locker();
+    void lock();
+    bool timed_lock(const struct timespec& timeout);
+    bool try_lock();
+    void unlock();
+    void lock_sharable();
+    bool timed_lock_sharable(const struct timespec& timeout);
+    bool try_lock_sharable();
+    void unlock_sharable();
+private:
+    shared_pi_locker(const shared_pi_locker& );
+    shared_pi_locker& operator=(const shared_pi_locker& );
+private:
+    pthread_mutex_t m_lock;
+};
+
+/**
+ * Simple class for RW locker that keeps the writer bit and the count of
+ * readers in one word and parks waiters on a futex
+ */
+class shared_futex_locker
+{
+public:
+    shared_futex_locker();
+    void lock();
+    bool timed_lock(const struct timespec& timeout);
+    bool try_lock();
+    void unlock();
+    void lock_sharable();
+    bool timed_lock_sharable(const struct timespec& timeout);
+    bool try_lock_sharable();
+    void unlock_sharable();
+private:
+    shared_futex_locker(const shared_futex_locker& );
+    shared_futex_locker& operator=(const shared_futex_locker& );
+    bool wait(const uint32_t mask, const struct timespec *pdeadline); ///< wait while the mask bits are set
+    void wake(); ///< wake all the waiters
+private:
+    enum
+    {
+        SPIN_COUNT      = 16,
+        WRITER          = 0x80000000, ///< the writer holds the locker
+        WAITERS         = 0x40000000, ///< someone sleeps on the futex
+        READERS         = 0x3fffffff  ///< the mask of the count of readers
+    };
+    volatile uint32_t m_state;
+};
+
+/**
+ * Simple class for phase-fair RW locker: writers are served in the order
+ * of their tickets and a waiting writer stops new readers, while the readers
+ * that arrived during a write phase enter right after it. So neither side
+ * can be starved by a stream of the other one.
+ * A timed writer can't leave the queue of writers, its timeout covers only
+ * the waiting for readers.
+ */
+class shared_fair_locker
+{
+public:
+    shared_fair_locker();
+    void lock();
+    bool timed_lock(const struct timespec& timeout);
+    bool try_lock();
+    void unlock();
+    void lock_sharable();
+    bool timed_lock_sharable(const struct timespec& timeout);
+    bool try_lock_sharable();
+    void unlock_sharable();
+private:
+    shared_fair_locker(const shared_fair_locker& );
+    shared_fair_locker& operator=(const shared_fair_locker& );
+    bool lock_readers(const uint32_t ticket, const struct timespec *pdeadline); ///< block new readers and wait for the old ones
+    bool wait_phase(const uint32_t phase, const struct timespec *pdeadline); ///< wait while the write phase lasts
+    void cancel_reader(const uint32_t phase); ///< withdraw the reader that arrived during the write phase
+    void leave(); ///< finish the write phase
+private:
+    enum
+    {
+        READER      = 0x100, ///< the increment of a reader
+        WRITER_BITS = 0x3, ///< the bits of a writer
+        PRESENT     = 0x2, ///< a writer is present
+        PHASE       = 0x1 ///< the phase of the present writer
+    };
+    volatile uint32_t m_rin; ///< the entered readers and the bits of the present writer
+    volatile uint32_t m_rout; ///< the left readers
+    volatile uint32_t m_win; ///< the tickets of writers
+    volatile uint32_t m_wout; ///< the served writers
+};
+
 /** Type to indicate to a locker constructor that must not lock it */
 struct defer_lock_type{};
 /** Type to indicate to a locker constructor that must try to lock it */
@@ -157,6 +316,101 @@ public:
     {}
 };
 
+/**
+ * The pair of lockers for a queue whose producers and consumers work on its
+ * opposite ends: producers serialize on one locker and consumers on the
+ * other one, so a push doesn't wait for a get or a pop. The exclusive and
+ * the sharable locks of the pair take both lockers, the producers' one first,
+ * consumers never take the producers' locker, so the order can't deadlock.
+ */
+template <typename Locker>
+class shared_dual_locker
+{
+public:
+    typedef Locker locker_type;
+    shared_dual_locker();
+    void lock();
+    bool timed_lock(const struct timespec& timeout);
+    bool try_lock();
+    void unlock();
+    void lock_sharable();
+    bool timed_lock_sharable(const struct timespec& timeout);
+    bool try_lock_sharable();
+    void unlock_sharable();
+    bool try_lock_producer(); ///< try to lock the producers' locker
+    bool timed_lock_producer(const struct timespec& timeout); ///< lock the producers' locker until the time comes
+    void unlock_producer(); ///< unlock the producers' locker
+    locker_type& consumer(); ///< get the consumers' locker
+    bool exclusive_push() const; ///< check if producers take the consumers' locker too
+    void exclusive_push(const bool value); ///< make producers take the consumers' locker too
+private:
+    enum
+    {
+        CACHE_LINE_SIZE = 64
+    };
+    shared_dual_locker(const shared_dual_locker& );
+    shared_dual_locker& operator=(const shared_dual_locker& );
+private:
+    locker_type m_producer;
+    volatile uint32_t m_exclusive_push; ///< a push removes expired messages, so it works on both ends
+    uint8_t m_padding[CACHE_LINE_SIZE]; ///< keeps the lockers on separate cache lines
+    locker_type m_consumer;
+};
+
+/**
+ * Make producers of the queue take the consumers' locker too, only the dual
+ * locker separates them
+ */
+template <typename Locker>
+inline void exclusive_push(Locker& , const bool )
+{
+}
+
+template <typename Locker>
+inline void exclusive_push(shared_dual_locker<Locker>& locker, const bool value)
+{
+    locker.exclusive_push(value);
+}
+
+/**
+ * Class producer_try_lock tries to lock the producers' locker of
+ * the shared_dual_locker
+ */
+template <typename Locker>
+class producer_try_lock
+{
+public:
+    typedef Locker locker_type;
+    explicit producer_try_lock(locker_type& locker);
+    producer_try_lock(locker_type& locker, const struct timespec& timeout);
+    ~producer_try_lock();
+    void unlock();
+    bool owns() const;
+private:
+    producer_try_lock();
+    producer_try_lock(const producer_try_lock& );
+    producer_try_lock& operator=(const producer_try_lock& );
+private:
+    locker_type& m_locker;
+    bool m_locked;
+};
+
+/**
+ * Class consumer_try_lock tries to lock the consumers' locker of
+ * the shared_dual_locker by the Lock: scoped_lock or sharable_lock
+ */
+template <typename Locker, typename Lock>
+class consumer_try_lock : public Lock
+{
+public:
+    explicit consumer_try_lock(Locker& locker) :
+        Lock(locker.consumer(), try_to_lock_type())
+    {}
+    consumer_try_lock(Locker& locker, const struct timespec& timeout) :
+        Lock(locker.consumer(), timeout)
+    {}
+};
+
 /**
  * The barrier hold all the waiting threads until some thread opens it
  */
@@ -178,6 +432,119 @@ private:
     mutable volatile uint32_t m_counter2;
 };
 
+/**
+ * The barrier that counts the waiting threads and parks them on a futex,
+ * it makes syscalls only if somebody waits
+ */
+class shared_futex_barrier
+{
+public:
+    shared_futex_barrier();
+    void open(); ///< open the barrier
+    void knock() const; ///< knock on the barrier
+    void wait() const; ///< wait until barrier opens
+    bool wait(const struct timespec& timeout) const; ///< wait until barrier opens
+    void expect() const; ///< expect the barrier to open
+    bool expect(const struct timespec& timeout) const; ///< expect the barrier to open
+private:
+    bool take() const; ///< take one of the posted wakeups
+private:
+    mutable volatile uint32_t m_waiters; ///< the count of knocked threads
+    mutable volatile uint32_t m_wakeups; ///< the count of posted wakeups, it's the futex
+};
+
+/**
+ * Hint the processor that the thread spins in a wait loop
+ */
+inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/**
+ * The wait strategy that spins on the core forever, it is meant for
+ * threads pinned to isolated cores where the latency is all that matters
+ */
+class busy_spin_wait
+{
+public:
+    bool parking() const { return false; } ///< check if the waiter should park
+    void idle() { cpu_relax(); } ///< idle a moment between polls
+};
+
+/**
+ * The wait strategy that spins a bounded time, then yields the core and
+ * finally sleeps a bit between polls
+ */
+class spin_yield_wait
+{
+public:
+    spin_yield_wait() : m_count(0) {}
+    bool parking() const { return false; } ///< check if the waiter should park
+    void idle() { boost::detail::yield(m_count++); } ///< idle a moment between polls
+private:
+    unsigned int m_count;
+};
+
+/**
+ * The wait strategy that spins a bounded time, then parks the waiter on
+ * the barrier of the connector, so an idle consumer doesn't burn the CPU.
+ * The waits that have nothing to park on yield the core instead.
+ */
+class spin_park_wait
+{
+public:
+    enum
+    {
+        SPIN_COUNT = 16
+    };
+    spin_park_wait() : m_count(0) {}
+    bool parking() const { return m_count >= SPIN_COUNT; } ///< check if the waiter should park
+    void idle() ///< idle a moment between polls
+    {
+        if (m_count++ < SPIN_COUNT)
+        {
+            cpu_relax();
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+private:
+    unsigned int m_count;
+};
+
+/**
+ * The guard of a writer of a sequence lock, the sequence is odd while the
+ * writer changes the protected data, so optimistic readers that snapshot it
+ * before and after their reads see the change and retry under a locker
+ */
+class sequence_guard
+{
+public:
+    explicit sequence_guard(volatile uint32_t& sequence) :
+        m_sequence(sequence)
+    {
+        __sync_fetch_and_add(&m_sequence, 1);
+    }
+    ~sequence_guard()
+    {
+        __sync_fetch_and_add(&m_sequence, 1);
+    }
+private:
+    sequence_guard(const sequence_guard& );
+    sequence_guard& operator=(const sequence_guard& );
+private:
+    volatile uint32_t& m_sequence;
+};
+
 /**
  * The simple spinlock
  */
@@ -483,6 +850,292 @@ bool sharable_lock<Locker>::owns() const
     return m_locked;
 }
 
+//==============================================================================
+//  shared_dual_locker
+//==============================================================================
+/**
+ * Constructor
+ */
+template <typename Locker>
+shared_dual_locker<Locker>::shared_dual_locker() :
+    m_exclusive_push(0)
+{
+}
+
+/**
+ * Set the exclusive lock of both lockers
+ */
+template <typename Locker>
+void shared_dual_locker<Locker>::lock()
+{
+    m_producer.lock();
+    m_consumer.lock();
+}
+
+/**
+ * Try to set the exclusive lock of both lockers until the time comes,
+ * each of them waits up to the timeout
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::timed_lock(const struct timespec& timeout)
+{
+    if (!m_producer.timed_lock(timeout))
+    {
+        return false;
+    }
+    if (!m_consumer.timed_lock(timeout))
+    {
+        m_producer.unlock();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Try to set the exclusive lock of both lockers
+ * @return the result of the setting
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::try_lock()
+{
+    if (!m_producer.try_lock())
+    {
+        return false;
+    }
+    if (!m_consumer.try_lock())
+    {
+        m_producer.unlock();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Remove the exclusive lock of both lockers
+ */
+template <typename Locker>
+void shared_dual_locker<Locker>::unlock()
+{
+    m_consumer.unlock();
+    m_producer.unlock();
+}
+
+/**
+ * Set the sharable lock of both lockers
+ */
+template <typename Locker>
+void shared_dual_locker<Locker>::lock_sharable()
+{
+    m_producer.lock_sharable();
+    m_consumer.lock_sharable();
+}
+
+/**
+ * Try to set the sharable lock of both lockers until the time comes,
+ * each of them waits up to the timeout
+ * @param timeout the allowable timeout of the setting
+ * @return the result of the setting
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::timed_lock_sharable(const struct timespec& timeout)
+{
+    if (!m_producer.timed_lock_sharable(timeout))
+    {
+        return false;
+    }
+    if (!m_consumer.timed_lock_sharable(timeout))
+    {
+        m_producer.unlock_sharable();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Try to set the sharable lock of both lockers
+ * @return the result of the setting
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::try_lock_sharable()
+{
+    if (!m_producer.try_lock_sharable())
+    {
+        return false;
+    }
+    if (!m_consumer.try_lock_sharable())
+    {
+        m_producer.unlock_sharable();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Remove the sharable lock of both lockers
+ */
+template <typename Locker>
+void shared_dual_locker<Locker>::unlock_sharable()
+{
+    m_consumer.unlock_sharable();
+    m_producer.unlock_sharable();
+}
+
+/**
+ * Try to lock the producers' locker, and the consumers' one if a push
+ * removes expired messages
+ * @return the result of the locking
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::try_lock_producer()
+{
+    if (!m_producer.try_lock())
+    {
+        return false;
+    }
+    if (exclusive_push() && !m_consumer.try_lock())
+    {
+        m_producer.unlock();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Lock the producers' locker until the time comes, and the consumers' one
+ * if a push removes expired messages
+ * @param timeout the allowable timeout of the locking
+ * @return the result of the locking
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::timed_lock_producer(const struct timespec& timeout)
+{
+    if (!m_producer.timed_lock(timeout))
+    {
+        return false;
+    }
+    if (exclusive_push() && !m_consumer.timed_lock(timeout))
+    {
+        m_producer.unlock();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Unlock the producers' locker
+ */
+template <typename Locker>
+void shared_dual_locker<Locker>::unlock_producer()
+{
+    if (exclusive_push())
+    {
+        m_consumer.unlock();
+    }
+    m_producer.unlock();
+}
+
+/**
+ * Get the consumers' locker
+ * @return the consumers' locker
+ */
+template <typename Locker>
+typename shared_dual_locker<Locker>::locker_type& shared_dual_locker<Locker>::consumer()
+{
+    return m_consumer;
+}
+
+/**
+ * Check if producers take the consumers' locker too
+ * @return the result of the checking
+ */
+template <typename Locker>
+bool shared_dual_locker<Locker>::exclusive_push() const
+{
+    return m_exclusive_push != 0;
+}
+
+/**
+ * Make producers take the consumers' locker too, it must be called under
+ * the exclusive lock
+ * @param value producers take the consumers' locker
+ */
+template <typename Locker>
+void shared_dual_locker<Locker>::exclusive_push(const bool value)
+{
+    m_exclusive_push = value ? 1 : 0;
+}
+
+//==============================================================================
+//  producer_try_lock
+//==============================================================================
+/**
+ * Constructor
+ * Try to lock the producers' locker immediately
+ * @param locker the slave locker
+ */
+template <typename Locker>
+producer_try_lock<Locker>::producer_try_lock(locker_type& locker) :
+    m_locker(locker),
+    m_locked(m_locker.try_lock_producer())
+{}
+
+/**
+ * Constructor
+ * Try to lock the producers' locker until the time comes
+ * @param locker the slave locker
+ * @param timeout the allowable timeout of the locking
+ */
+template <typename Locker>
+producer_try_lock<Locker>::producer_try_lock(locker_type& locker, const struct timespec& timeout) :
+    m_locker(locker),
+    m_locked(m_locker.timed_lock_producer(timeout))
+{}
+
+/**
+ * Destructor
+ * Unlock the producers' locker
+ */
+template <typename Locker>
+producer_try_lock<Locker>::~producer_try_lock()
+{
+    try
+    {
+        if (m_locked)
+        {
+            m_locker.unlock_producer();
+        }
+    }
+    catch (...)
+    {
+    }
+}
+
+/**
+ * Unlock the producers' locker
+ */
+template <typename Locker>
+void producer_try_lock<Locker>::unlock()
+{
+    if (!m_locked)
+    {
+        throw lock_exception();
+    }
+    m_locker.unlock_producer();
+    m_locked = false;
+}
+
+/**
+ * Check the lock is locked
+ * @return the result of the checking
+ */
+template <typename Locker>
+bool producer_try_lock<Locker>::owns() const
+{
+    return m_locked;
+}
+
 } //namespace qbus
 
 #endif /* QBUS_LOCKER_H */
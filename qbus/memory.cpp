@@ -1,4 +1,10 @@
 #include "qbus/memory.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <boost/make_shared.hpp>
 
 namespace qbus
@@ -78,6 +84,15 @@ bool shared_memory::open()
     return false;
 }
 
+/**
+ * Flush the memory to its backing store
+ * @return the result of the flushing
+ */
+bool shared_memory::flush()
+{
+    return m_pregion ? m_pregion->flush() : false;
+}
+
 /**
  * Get the pointer to the memory
  * @return the pointer to the memory
@@ -104,5 +119,232 @@ void shared_memory::remove()
     boost::interprocess::shared_memory_object::remove(m_name.c_str());
 }
 
+//==============================================================================
+//  mapped_file
+//==============================================================================
+/**
+ * Constructor
+ * @param name the name of the file
+ */
+mapped_file::mapped_file(const std::string& name) :
+    m_name(name),
+    m_fd(-1),
+    m_exclusive(false)
+{
+}
+
+/**
+ * Destructor
+ * The file isn't removed, it keeps the memory until the next opening
+ */
+//virtual
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+/**
+ * Create the memory
+ * @param size the size of the memory
+ * @return the result of the creating
+ */
+bool mapped_file::create(const size_t size)
+{
+    if (m_fd < 0)
+    {
+        m_fd = ::open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+        /* the file is zero-filled, so the spinlock is locked by default
+         * like in a new shared memory object */
+        if (lock(F_WRLCK, false) && 0 == ftruncate(m_fd, size) && map())
+        {
+            return true;
+        }
+        close();
+        remove(m_name);
+    }
+    return false;
+}
+
+/**
+ * Open the memory
+ * @return the result of the opening
+ */
+bool mapped_file::open()
+{
+    if (m_fd < 0)
+    {
+        m_fd = ::open(m_name.c_str(), O_RDWR);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+        /* the exclusive lock is got only if nobody is attached to the file */
+        if ((lock(F_WRLCK, false) || lock(F_RDLCK, true)) && map())
+        {
+            return true;
+        }
+        close();
+    }
+    return false;
+}
+
+/**
+ * Lock the file
+ * Open file description locks are used, they belong to the descriptor
+ * (not to the process) and the conversion of them is atomic
+ * @param type the type of the lock
+ * @param wait the flag to wait for the lock
+ * @return the result of the locking
+ */
+bool mapped_file::lock(const short type, const bool wait)
+{
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    int result;
+    do
+    {
+        result = fcntl(m_fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl);
+    } while (result != 0 && EINTR == errno);
+    if (0 == result)
+    {
+        m_exclusive = F_WRLCK == type;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Map the file
+ * @return the result of the mapping
+ */
+bool mapped_file::map()
+{
+    using namespace boost::interprocess;
+    try
+    {
+        pmapping_type pmapping = boost::make_shared<mapping_type>(
+            m_name.c_str(), read_write);
+        m_pregion = boost::make_shared<region_type>(*pmapping, read_write);
+        m_pmapping = pmapping;
+        return true;
+    }
+    catch (...)
+    {
+        m_pregion.reset();
+    }
+    return false;
+}
+
+/**
+ * Close the file
+ */
+void mapped_file::close()
+{
+    m_pregion.reset();
+    m_pmapping.reset();
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_exclusive = false;
+}
+
+/**
+ * Check if nobody else is attached to the memory
+ * @return the result of the checking
+ */
+bool mapped_file::exclusive() const
+{
+    return m_exclusive;
+}
+
+/**
+ * Let other objects attach to the memory
+ */
+void mapped_file::share()
+{
+    if (m_exclusive)
+    {
+        lock(F_RDLCK, true);
+    }
+}
+
+/**
+ * Flush the memory to its backing store
+ * @return the result of the flushing
+ */
+bool mapped_file::flush()
+{
+    return m_pregion ? m_pregion->flush(0, 0, false) : false;
+}
+
+/**
+ * Get the pointer to the memory
+ * @return the pointer to the memory
+ */
+void *mapped_file::get() const
+{
+    return m_pregion ? m_pregion->get_address() : NULL;
+}
+
+/**
+ * Get the size of the memory
+ * @return the size of the memory
+ */
+size_t mapped_file::size() const
+{
+    return m_pregion ? m_pregion->get_size() : 0;
+}
+
+/**
+ * Remove the memory
+ * @param name the name of the file
+ * @return the result of the removing
+ */
+//static
+bool mapped_file::remove(const std::string& name)
+{
+    return boost::interprocess::file_mapping::remove(name.c_str());
+}
+
+//==============================================================================
+//  functions
+//==============================================================================
+/**
+ * Populate the pages of the memory, so the first writes to them don't fault.
+ * The memory keeps its content, a page is touched by an atomic addition of
+ * zero if the kernel can't populate it in place.
+ * @param ptr the pointer to the memory
+ * @param size the size of the memory
+ * @return the size of the populated memory
+ */
+size_t prefault(void *ptr, const size_t size)
+{
+    if (NULL == ptr || 0 == size)
+    {
+        return 0;
+    }
+#ifdef MADV_POPULATE_WRITE
+    if (0 == madvise(ptr, size, MADV_POPULATE_WRITE))
+    {
+        return size;
+    }
+#endif
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t *first = reinterpret_cast<uint8_t*>(ptr);
+    for (size_t offset = 0; offset < size; offset += page_size)
+    {
+        __sync_fetch_and_add(first + offset, 0);
+    }
+    return size;
+}
+
 } //namespace memory
 } //namespace qbus
@@ -5,6 +5,7 @@
 #include <string>
 #include <boost/shared_ptr.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
 
 namespace qbus
@@ -12,13 +13,20 @@ namespace qbus
 namespace memory
 {
 
+/**
+ * The memory that is placed in a shared memory object
+ */
 class shared_memory
 {
 public:
+    static const bool persistent = false; ///< the memory doesn't survive reboots
     explicit shared_memory(const std::string& name);
     virtual ~shared_memory();
     bool create(const size_t size); ///< create the memory
     bool open(); ///< open the memory
+    bool flush(); ///< flush the memory to its backing store
+    bool exclusive() const { return false; } ///< check if nobody else is attached to the memory
+    void share() {} ///< let other objects attach to the memory
     size_t size() const; ///< get the size of the memory
     void *get() const; ///< get the pointer to the memory
 protected:
@@ -34,9 +42,50 @@ private:
     pregion_type m_pregion;
 };
 
+/**
+ * The memory that is placed in a regular file mapped to all processes,
+ * so its content survives reboots and isn't limited by the size of tmpfs.
+ * Each object holds a lock on the file while it is mapped, that lets the
+ * first object attached after a reboot or a crash know that the file is
+ * left by all processes. The file isn't removed by the destructor, its
+ * owner removes it by `mapped_file::remove` when the data isn't needed.
+ */
+class mapped_file
+{
+public:
+    static const bool persistent = true; ///< the memory survives reboots
+    explicit mapped_file(const std::string& name);
+    virtual ~mapped_file();
+    bool create(const size_t size); ///< create the memory
+    bool open(); ///< open the memory
+    bool flush(); ///< flush the memory to its backing store
+    bool exclusive() const; ///< check if nobody else is attached to the memory
+    void share(); ///< let other objects attach to the memory
+    size_t size() const; ///< get the size of the memory
+    void *get() const; ///< get the pointer to the memory
+    static bool remove(const std::string& name); ///< remove the memory
+private:
+    bool lock(const short type, const bool wait); ///< lock the file
+    bool map(); ///< map the file
+    void close(); ///< close the file
+    typedef boost::interprocess::file_mapping mapping_type;
+    typedef boost::shared_ptr<mapping_type> pmapping_type;
+    typedef boost::interprocess::mapped_region region_type;
+    typedef boost::shared_ptr<region_type> pregion_type;
+private:
+    const std::string m_name;
+    int m_fd; ///< the descriptor that holds the lock on the file
+    bool m_exclusive; ///< the lock on the file is exclusive
+    pmapping_type m_pmapping;
+    pregion_type m_pregion;
+};
+
+size_t prefault(void *ptr, const size_t size); ///< populate the pages of the memory
+
 } //namespace memory
 
 typedef memory::shared_memory shared_memory_type;
+typedef memory::mapped_file mapped_file_type;
 typedef boost::shared_ptr<shared_memory_type> pshared_memory_type;
 
 } //namespace qbus
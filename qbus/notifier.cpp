@@ -0,0 +1,248 @@
+#include "qbus/notifier.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <boost/interprocess/detail/atomic.hpp>
+
+namespace qbus
+{
+
+//==============================================================================
+//  notifier
+//==============================================================================
+/**
+ * Constructor
+ */
+notifier::notifier() :
+    m_ptable(NULL),
+    m_slot(-1),
+    m_fd(-1)
+{
+}
+
+/**
+ * Destructor
+ */
+notifier::~notifier()
+{
+    close();
+}
+
+/**
+ * Get size of the table of subscribers
+ * @return size of the table of subscribers
+ */
+//static
+size_t notifier::table_size()
+{
+    return sizeof(table_type);
+}
+
+/**
+ * Create the table of subscribers
+ * @param ptr pointer to the place where the table will be built
+ * @param name the name of the owner of the table
+ * @return pointer to memory region after the table
+ */
+void *notifier::create_table(void *ptr, const std::string& name)
+{
+    memset(ptr, 0, sizeof(table_type));
+    return open_table(ptr, name);
+}
+
+/**
+ * Open the table of subscribers
+ * @param ptr pointer to the place where the table is located
+ * @param name the name of the owner of the table
+ * @return pointer to memory region after the table
+ */
+void *notifier::open_table(void *ptr, const std::string& name)
+{
+    m_ptable = reinterpret_cast<table_type*>(ptr);
+    m_name = name;
+    return reinterpret_cast<uint8_t*>(ptr) + sizeof(table_type);
+}
+
+/**
+ * Get the address of the socket of the slot
+ * @param slot the slot of a subscriber
+ * @param addr the address
+ * @param size the size of the address
+ * @return false if the name of the owner is too long
+ */
+bool notifier::address(const size_t slot, struct sockaddr_un& addr, socklen_t& size) const
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    /* the first zero byte of the path means the abstract namespace, so the
+     * socket disappears with its descriptor */
+    const int length = snprintf(addr.sun_path + 1, sizeof(addr.sun_path) - 1,
+        "qbus.%s.%u", m_name.c_str(), static_cast<unsigned int>(slot));
+    if (length < 0 || static_cast<size_t>(length) >= sizeof(addr.sun_path) - 1)
+    {
+        return false;
+    }
+    size = offsetof(struct sockaddr_un, sun_path) + 1 + length;
+    return true;
+}
+
+/**
+ * Take a slot and bind its socket
+ * @return the result of the subscribing
+ */
+bool notifier::subscribe() const
+{
+    using namespace boost::interprocess::ipcdetail;
+    const uint32_t self = getpid();
+    for (size_t i = 0; i < SLOTS_COUNT; ++i)
+    {
+        slot_type& slot = m_ptable->slots[i];
+        const uint32_t pid = atomic_read32(&slot.pid);
+        /* the slot of a dead process is taken over, its socket has gone */
+        if (pid != 0 && (kill(pid, 0) == 0 || errno != ESRCH))
+        {
+            continue;
+        }
+        if (atomic_cas32(&slot.pid, self, pid) != pid)
+        {
+            continue;
+        }
+        struct sockaddr_un addr;
+        socklen_t size = 0;
+        const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && address(i, addr, size) &&
+            bind(fd, reinterpret_cast<struct sockaddr*>(&addr), size) == 0)
+        {
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+            m_fd = fd;
+            m_slot = i;
+            atomic_write32(&slot.signalled, 0);
+            if (0 == pid)
+            {
+                atomic_inc32(&m_ptable->count);
+            }
+            return true;
+        }
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        atomic_write32(&slot.pid, 0);
+        if (pid != 0)
+        {
+            atomic_dec32(&m_ptable->count);
+        }
+        return false;
+    }
+    return false;
+}
+
+/**
+ * Subscribe and get the descriptor to wait on. The descriptor becomes
+ * readable after a message is pushed, the subscriber acknowledges it by
+ * reading until the owner is empty.
+ * @return the descriptor or -1
+ */
+int notifier::native_handle() const
+{
+    if (m_slot < 0 && (NULL == m_ptable || !subscribe()))
+    {
+        return -1;
+    }
+    return m_fd;
+}
+
+/**
+ * Send a byte to the socket of the slot
+ * @param slot the slot of a subscriber
+ * @return the result of the sending
+ */
+bool notifier::signal(const size_t slot)
+{
+    if (m_fd < 0)
+    {
+        m_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_fd < 0)
+        {
+            return false;
+        }
+    }
+    struct sockaddr_un addr;
+    socklen_t size = 0;
+    const char data = 1;
+    return address(slot, addr, size) && (sendto(m_fd, &data, sizeof(data),
+        MSG_DONTWAIT | MSG_NOSIGNAL, reinterpret_cast<struct sockaddr*>(&addr), size) > 0 ||
+        EAGAIN == errno);
+}
+
+/**
+ * Signal all subscribers
+ */
+void notifier::notify()
+{
+    using namespace boost::interprocess::ipcdetail;
+    if (NULL == m_ptable || 0 == m_ptable->count)
+    {
+        return;
+    }
+    for (size_t i = 0; i < SLOTS_COUNT; ++i)
+    {
+        slot_type& slot = m_ptable->slots[i];
+        if (0 == slot.pid || slot.signalled != 0 ||
+            atomic_cas32(&slot.signalled, 1, 0) != 0)
+        {
+            continue;
+        }
+        if (!signal(i))
+        {
+            atomic_write32(&slot.signalled, 0);
+        }
+    }
+}
+
+/**
+ * Consume the signal of this subscriber, the owner must be checked again
+ * after it because messages pushed before it are not signalled
+ * @return false if there was no signal
+ */
+bool notifier::acknowledge() const
+{
+    using namespace boost::interprocess::ipcdetail;
+    if (m_slot < 0 || 0 == atomic_read32(&m_ptable->slots[m_slot].signalled))
+    {
+        return false;
+    }
+    atomic_write32(&m_ptable->slots[m_slot].signalled, 0);
+    char data[64];
+    while (recv(m_fd, data, sizeof(data), MSG_DONTWAIT) > 0)
+    {
+    }
+    return true;
+}
+
+/**
+ * Unsubscribe and forget the table
+ */
+void notifier::close()
+{
+    using namespace boost::interprocess::ipcdetail;
+    if (m_slot >= 0)
+    {
+        atomic_write32(&m_ptable->slots[m_slot].pid, 0);
+        atomic_dec32(&m_ptable->count);
+        m_slot = -1;
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_ptable = NULL;
+}
+
+} //namespace qbus
@@ -0,0 +1,66 @@
+#ifndef QBUS_NOTIFIER_H
+#define QBUS_NOTIFIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace qbus
+{
+
+/**
+ * The notifier lets a subscriber wait for pushed messages in an event loop
+ * (select, poll, epoll) among other descriptors. The table of subscribers is
+ * placed in the shared memory of a connector or a bus, every subscriber binds
+ * a datagram socket in the abstract namespace and producers send a byte to
+ * it when they push a message. The sending is skipped until the subscriber
+ * acknowledges the previous one, so producers pay a single load when nobody
+ * subscribes and at most one syscall per subscriber between acknowledgements.
+ * A socket is used instead of an eventfd because an eventfd can't be shared
+ * with unrelated processes by a name, and instead of a FIFO because writing
+ * to a FIFO of a dead subscriber raises SIGPIPE in the producer.
+ */
+class notifier
+{
+public:
+    enum
+    {
+        SLOTS_COUNT = 16 ///< the maximum count of subscribers
+    };
+    notifier();
+    ~notifier();
+    static size_t table_size(); ///< get size of the table of subscribers
+    void *create_table(void *ptr, const std::string& name); ///< create the table of subscribers
+    void *open_table(void *ptr, const std::string& name); ///< open the table of subscribers
+    int native_handle() const; ///< subscribe and get the descriptor to wait on
+    void notify(); ///< signal all subscribers
+    bool acknowledge() const; ///< consume the signal of this subscriber
+    void close(); ///< unsubscribe and forget the table
+private:
+    notifier(const notifier&);
+    notifier& operator=(const notifier&);
+    struct slot_type
+    {
+        volatile uint32_t pid; ///< the process of the subscriber or 0
+        volatile uint32_t signalled; ///< the subscriber has an unacknowledged signal
+    };
+    struct table_type
+    {
+        volatile uint32_t count; ///< the count of subscribers
+        slot_type slots[SLOTS_COUNT];
+    };
+    bool address(const size_t slot, struct sockaddr_un& addr, socklen_t& size) const; ///< get the address of the slot
+    bool subscribe() const; ///< take a slot and bind its socket
+    bool signal(const size_t slot); ///< send a byte to the socket of the slot
+private:
+    table_type *m_ptable;
+    std::string m_name;
+    mutable int m_slot; ///< the slot of this subscriber or -1
+    mutable int m_fd; ///< the socket, it's bound to the slot of this subscriber
+};
+
+} //namespace qbus
+
+#endif /* QBUS_NOTIFIER_H */
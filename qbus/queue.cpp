@@ -1,7 +1,11 @@
 #include "qbus/queue.h"
 #include "qbus/common.h"
+#include <errno.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <boost/make_shared.hpp>
 #include <boost/interprocess/detail/atomic.hpp>
 #ifdef QBUS_TEST_ENABLED 
@@ -109,7 +113,7 @@ void base_queue::keepalive_timeout(const size_t value)
 //virtual
 size_t base_queue::count() const
 {
-    return *reinterpret_cast<const uint32_t*>(m_ptr + COUNT_OFFSET);
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<uint32_t*>(m_ptr + COUNT_OFFSET));
 }
 
 /**
@@ -121,6 +125,26 @@ void base_queue::count(const size_t value)
     *reinterpret_cast<uint32_t*>(m_ptr + COUNT_OFFSET) = value;
 }
 
+/**
+ * Increase the count of messages, a writer that holds only the locker of
+ * producers publishes a message by it to readers
+ * @return the count of messages
+ */
+size_t base_queue::inc_count()
+{
+    return boost::interprocess::ipcdetail::atomic_inc32(reinterpret_cast<uint32_t*>(m_ptr + COUNT_OFFSET)) + 1;
+}
+
+/**
+ * Reduce the count of messages, a reader that holds only the locker of
+ * consumers releases the space of a message by it to writers
+ * @return the count of messages
+ */
+size_t base_queue::dec_count()
+{
+    return boost::interprocess::ipcdetail::atomic_dec32(reinterpret_cast<uint32_t*>(m_ptr + COUNT_OFFSET)) - 1;
+}
+
 /**
  * Check the queue is empty 
  * @return 
@@ -137,7 +161,7 @@ bool base_queue::empty() const
 //virtual
 pos_type base_queue::head() const
 {
-    return *reinterpret_cast<const pos_type*>(m_ptr + HEAD_OFFSET);
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<pos_type*>(m_ptr + HEAD_OFFSET));
 }
 
 /**
@@ -197,6 +221,23 @@ size_t base_queue::size() const
     return static_size(capacity());
 }
 
+/**
+ * Get the size of the busy space of the queue, i.e. the space from the
+ * head to the tail. It's approximate while the queue is changed by others,
+ * and it includes the messages that aren't collected yet.
+ * @return the size of the busy space of the queue
+ */
+size_t base_queue::usage() const
+{
+    if (0 == base_queue::count())
+    {
+        return 0;
+    }
+    const pos_type hd = base_queue::head();
+    const pos_type tl = tail();
+    return hd < tl ? tl - hd : capacity() - hd + tl;
+}
+
 /**
  * Collect garbage
  * @return the number of cleaned messages
@@ -206,6 +247,98 @@ size_t base_queue::clean()
     return clean_messages().first;
 }
 
+/**
+ * Return the memory pages of free regions to the OS
+ * The free regions lie between the tail and the head of the queue, so they
+ * don't keep any data and their pages can be dropped until the next push
+ * touches them again. The caller must hold the exclusive lock of the queue.
+ * @return the size of the memory whose backing store was released, pages
+ * that were already released by a previous call are counted again
+ */
+size_t base_queue::reclaim()
+{
+    clean_messages();
+    size_t result = 0;
+    region_type region = base_queue::get_free_region();
+    for (size_t i = 0; i < 2 && region.second > 0; ++i)
+    {
+        result += reclaim_region(region);
+        region = base_queue::get_free_region(&region);
+    }
+    return result;
+}
+
+/**
+ * Return the memory pages of the region to the OS
+ * @param region the free region of the queue
+ * @return the size of the memory whose backing store was released
+ */
+size_t base_queue::reclaim_region(const region_type& region) const
+{
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = reinterpret_cast<uintptr_t>(data(region.first));
+    const uintptr_t first = (begin + page_size - 1) & ~(page_size - 1);
+    const uintptr_t last = (begin + region.second) & ~(page_size - 1);
+    if (last > first)
+    {
+        void *ptr = reinterpret_cast<void*>(first);
+        const size_t size = last - first;
+        /* only MADV_REMOVE frees the backing store of a shared mapping,
+         * MADV_DONTNEED just drops the page table entries of this process
+         * so it isn't counted */
+        if (0 == madvise(ptr, size, MADV_REMOVE))
+        {
+            return size;
+        }
+        madvise(ptr, size, MADV_DONTNEED);
+    }
+    return 0;
+}
+
+/**
+ * Recount the messages between the head and the tail. A writer that died
+ * between the setting of the tail (or the head) and the count leaves the
+ * count wrong, while a message written beyond the tail is just free space.
+ * It must be called under the exclusive lock of the queue.
+ * @return the count of messages
+ */
+size_t base_queue::repair()
+{
+    const size_t cpct = capacity();
+    const size_t header_size = message::base_message::static_size(0);
+    const pos_type tl = tail();
+    pos_type pos = base_queue::head();
+    size_t cnt = 0;
+    if (pos != tl || base_queue::count() > 0)
+    {
+        size_t rest = cpct;
+        do
+        {
+            if (cpct - pos <= header_size)
+            {
+                /* the writer skips the end of the data region that can't
+                 * hold a message */
+                rest -= std::min(rest, cpct - pos);
+                pos = 0;
+            }
+            const pmessage_type pmessage = make_message(data(pos));
+            const size_t sz = pmessage->size();
+            if (sz <= header_size || sz > rest)
+            {
+                break;
+            }
+            if (pmessage->flags() & message::FLG_TAIL)
+            {
+                ++cnt;
+            }
+            rest -= sz;
+            pos = (pos + sz) % cpct;
+        } while (pos != tl);
+    }
+    count(cnt);
+    return cnt;
+}
+
 /**
  * Collect garbage
  * @return the information about collected garbage
@@ -230,13 +363,25 @@ bool base_queue::do_push(const tag_type tag, const void *data, const size_t size
     if (message_desc.first)
     {
         message_desc.first->tag(tag);
-        tail(message_desc.second);
-        count(base_queue::count() + 1);
+        commit_message(message_desc);
         return true;
     }
     return false;
 }
 
+/**
+ * Publish the pushed message to readers. The tail is moved before the count
+ * is increased, so a reader that sees the message sees its end too, even if
+ * it doesn't hold the locker of producers.
+ * @param message_desc the description of the message
+ */
+//virtual
+void base_queue::commit_message(const message_desc_type& message_desc)
+{
+    tail(message_desc.second);
+    inc_count();
+}
+
 /**
  * Push data to the queue
  * @param tag the tag of the message
@@ -467,8 +612,10 @@ simple_queue::message_desc_type simple_queue::get_message() const
 void simple_queue::pop_message(const message_desc_type& message_desc)
 {
     message_desc.first->dec_counter();
+    /* the count is reduced before the head is moved, so a writer that
+     * sees the new head never takes the queue for a full one */
+    dec_count();
     head(message_desc.second);
-    count(count() - 1); ///@todo !!!! dec count && inc count
 }
 
 /**
@@ -567,7 +714,7 @@ size_t base_shared_queue::dec_subscriptions_count()
  */
 uint32_t base_shared_queue::counter() const
 {
-    return *reinterpret_cast<const uint32_t*>(m_ptr + COUNTER_OFFSET);
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<uint32_t*>(m_ptr + COUNTER_OFFSET));
 }
 
 /**
@@ -654,11 +801,22 @@ base_shared_queue::message_desc_type base_shared_queue::push_message(const void
     if (message_desc.first)
     {
         message_desc.first->counter(subscriptions_count());
-        counter(counter() + 1);
     }
     return message_desc;
 }
 
+/**
+ * Publish the pushed message to readers, the counter of pushed messages is
+ * increased after the tail is moved
+ * @param message_desc the description of the message
+ */
+//virtual
+void base_shared_queue::commit_message(const message_desc_type& message_desc)
+{
+    base_queue::commit_message(message_desc);
+    boost::interprocess::ipcdetail::atomic_inc32(reinterpret_cast<uint32_t*>(m_ptr + COUNTER_OFFSET));
+}
+
 /**
  * Get a message from the queue
  * @return the description of the message
@@ -785,11 +943,49 @@ unreadable_shared_queue::garbage_info_type unreadable_shared_queue::clean_messag
 smart_shared_queue::smart_shared_queue(void *ptr) : 
     base_shared_queue(reinterpret_cast<uint8_t*>(ptr) + HEADER_SIZE),
     m_ptr(reinterpret_cast<uint8_t*>(ptr)),
-    m_state(ST_UNKNOWN)
+    m_state(ST_UNKNOWN),
+    m_pslot(NULL),
+    m_unsubscribed(false)
 {
     initialize();
 }
 
+/**
+ * Constructor
+ * @param ptr the pointer to the header of the queue
+ * @param join the place where the subscriber starts reading
+ */
+smart_shared_queue::smart_shared_queue(void *ptr, const join_type join) : 
+    base_shared_queue(reinterpret_cast<uint8_t*>(ptr) + HEADER_SIZE),
+    m_ptr(reinterpret_cast<uint8_t*>(ptr)),
+    m_state(ST_UNKNOWN),
+    m_pslot(NULL),
+    m_unsubscribed(false)
+{
+    initialize(join);
+}
+
+/**
+ * Constructor of a durable subscription, the subscriber resumes reading from
+ * the position where the previous subscriber with the same name stopped
+ * @param ptr the pointer to the header of the queue
+ * @param name the name of the subscription
+ * @param join the place where a new subscriber starts reading
+ */
+smart_shared_queue::smart_shared_queue(void *ptr, const std::string& name, const join_type join) : 
+    base_shared_queue(reinterpret_cast<uint8_t*>(ptr) + HEADER_SIZE),
+    m_ptr(reinterpret_cast<uint8_t*>(ptr)),
+    m_state(ST_UNKNOWN),
+    m_pslot(NULL),
+    m_unsubscribed(false)
+{
+    if (!attach(name))
+    {
+        initialize(join);
+        save_position();
+    }
+}
+
 /**
  * Constructor
  * @param qid the identifier of the queue
@@ -799,9 +995,15 @@ smart_shared_queue::smart_shared_queue(void *ptr) :
 smart_shared_queue::smart_shared_queue(const id_type qid, void *ptr, const size_t cpct) : 
     base_shared_queue(qid, reinterpret_cast<uint8_t*>(ptr) + HEADER_SIZE, cpct),
     m_ptr(reinterpret_cast<uint8_t*>(ptr)),
-    m_state(ST_UNKNOWN)
+    m_state(ST_UNKNOWN),
+    m_pslot(NULL),
+    m_unsubscribed(false)
 {
     free_space(capacity());
+    data_count(0);
+    retention(0, 0);
+    durable_limit(0);
+    memset(slots(), 0, SLOTS_SIZE);
     initialize();
 }
 
@@ -813,7 +1015,9 @@ smart_shared_queue::smart_shared_queue(const id_type qid, void *ptr, const size_
 smart_shared_queue::smart_shared_queue(void *ptr, pqueue_type pqueue) :
     base_shared_queue(reinterpret_cast<uint8_t*>(ptr) + HEADER_SIZE),
     m_ptr(reinterpret_cast<uint8_t*>(ptr)),
-    m_state(ST_UNKNOWN)
+    m_state(ST_UNKNOWN),
+    m_pslot(NULL),
+    m_unsubscribed(false)
 {
     if (!pqueue)
     {
@@ -853,8 +1057,14 @@ smart_shared_queue::smart_shared_queue(const id_type qid, void *ptr, const size_
         pqueue_type pqueue) :
     base_shared_queue(qid, reinterpret_cast<uint8_t*>(ptr) + HEADER_SIZE, cpct),
     m_ptr(reinterpret_cast<uint8_t*>(ptr)),
-    m_state(ST_UNKNOWN)
-{
+    m_state(ST_UNKNOWN),
+    m_pslot(NULL),
+    m_unsubscribed(false)
+{
+    data_count(0);
+    retention(0, 0);
+    durable_limit(0);
+    memset(slots(), 0, SLOTS_SIZE);
     if (!pqueue)
     {
         free_space(capacity());
@@ -863,6 +1073,7 @@ smart_shared_queue::smart_shared_queue(const id_type qid, void *ptr, const size_
     {
         smart_shared_queue *pq = dynamic_cast<smart_shared_queue*>(pqueue.get());
         assert(pq != NULL);
+        retention(pq->retention_count(), pq->retention_timeout());
         const size_t count = pq->subscriptions_count();
         if (count > 1)
         {
@@ -878,15 +1089,125 @@ smart_shared_queue::smart_shared_queue(const id_type qid, void *ptr, const size_
 
 /**
  * Initialize the queue
+ * @param join the place where the subscriber starts reading
  */
-void smart_shared_queue::initialize()
+void smart_shared_queue::initialize(const join_type join)
 {
     push_service_message(service_message_type::CODE_CONNECT);
     m_head = tail();
     m_counter = counter();
+    if (JOIN_HISTORY == join)
+    {
+        join_history();
+    }
     inc_subscriptions_count();
 }
 
+/**
+ * Move the head of the subscriber to the first message of the retention
+ * window, the subscriber takes a reference to every message it will read
+ */
+void smart_shared_queue::join_history()
+{
+    size_t cnt = base_queue::count();
+    size_t rest = data_count();
+    const size_t now = qbus::message::get_timestamp();
+    m_head = base_queue::head();
+    while (cnt > 0)
+    {
+        m_counter = counter() - cnt;
+        const message_desc_type message_desc = base_shared_queue::get_message();
+        if (!message_desc.first)
+        {
+            break;
+        }
+        if (message_desc.first->tag() != service_message_type::TAG)
+        {
+            if (retained(message_desc.first->timestamp(), rest, now))
+            {
+                break;
+            }
+            --rest;
+        }
+        m_head = message_desc.second % capacity();
+        --cnt;
+    }
+    m_counter = counter() - cnt;
+    const pos_type head = m_head;
+    for (size_t i = 0; i < cnt; ++i)
+    {
+        const message_desc_type message_desc = base_shared_queue::get_message();
+        message_desc.first->inc_counter();
+        m_head = message_desc.second % capacity();
+        ++m_counter;
+    }
+    m_head = head;
+    m_counter = counter() - cnt;
+}
+
+/**
+ * Set the retention window of the queue, the messages that were read by all
+ * subscribers are kept in the queue for new subscribers until their space is
+ * needed for new messages
+ * @param count the count of the last data messages that are retained
+ * @param timeout the time in seconds while data messages are retained
+ */
+void smart_shared_queue::retention(const size_t count, const size_t timeout)
+{
+    boost::interprocess::ipcdetail::atomic_write32(reinterpret_cast<uint32_t*>(m_ptr + RETENTION_COUNT_OFFSET), count);
+    boost::interprocess::ipcdetail::atomic_write32(reinterpret_cast<uint32_t*>(m_ptr + RETENTION_TIMEOUT_OFFSET), timeout);
+}
+
+/**
+ * Get the count of retained messages
+ * @return the count of retained messages
+ */
+size_t smart_shared_queue::retention_count() const
+{
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<uint32_t*>(m_ptr + RETENTION_COUNT_OFFSET));
+}
+
+/**
+ * Get the time while messages are retained
+ * @return the time in seconds while messages are retained
+ */
+size_t smart_shared_queue::retention_timeout() const
+{
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<uint32_t*>(m_ptr + RETENTION_TIMEOUT_OFFSET));
+}
+
+/**
+ * Check if the data message is in the retention window
+ * @param timestamp the timestamp of the message
+ * @param rest the count of data messages from the message to the tail
+ * @param now the current timestamp
+ * @return the result of the checking
+ */
+bool smart_shared_queue::retained(const size_t timestamp, const size_t rest, const size_t now) const
+{
+    const size_t count = retention_count();
+    const size_t timeout = retention_timeout();
+    return (count > 0 && rest <= count) || (timeout > 0 && timestamp + timeout > now);
+}
+
+/**
+ * Get the count of data messages in the queue
+ * @return the count of data messages in the queue
+ */
+size_t smart_shared_queue::data_count() const
+{
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<uint32_t*>(m_ptr + DATA_COUNT_OFFSET));
+}
+
+/**
+ * Set the count of data messages in the queue
+ * @param value the count of data messages in the queue
+ */
+void smart_shared_queue::data_count(const size_t value)
+{
+    boost::interprocess::ipcdetail::atomic_write32(reinterpret_cast<uint32_t*>(m_ptr + DATA_COUNT_OFFSET), value);
+}
+
 /**
  * Get the free space of the queue
  * @return the free space of the queue
@@ -931,6 +1252,19 @@ size_t smart_shared_queue::dec_free_space(const size_t value)
 //virtual
 smart_shared_queue::~smart_shared_queue()
 {
+    if (m_pslot != NULL && !m_unsubscribed)
+    {
+        /* the durable subscription stays in the queue and keeps its messages
+         * until a subscriber with the same name attaches it again */
+        save_position();
+        m_pslot->sid = 0;
+        return;
+    }
+    if (m_pslot != NULL)
+    {
+        memset(m_pslot, 0, sizeof(durable_slot_type));
+        m_pslot = NULL;
+    }
     push_service_message(service_message_type::CODE_DISCONNECT);
     dec_subscriptions_count();
     while (1)
@@ -950,6 +1284,161 @@ smart_shared_queue::~smart_shared_queue()
     }
 }
 
+/**
+ * Check if the subscription is durable
+ * @return the result of the checking
+ */
+bool smart_shared_queue::durable() const
+{
+    return m_pslot != NULL;
+}
+
+/**
+ * Finish the durable subscription when the queue is destroyed
+ */
+void smart_shared_queue::unsubscribe()
+{
+    m_unsubscribed = true;
+}
+
+/**
+ * Get the count of messages kept for a detached subscription
+ * @return the count of messages, 0 if it's limited by the capacity only
+ */
+size_t smart_shared_queue::durable_limit() const
+{
+    return boost::interprocess::ipcdetail::atomic_read32(reinterpret_cast<uint32_t*>(m_ptr + DURABLE_LIMIT_OFFSET));
+}
+
+/**
+ * Set the count of messages kept for a detached subscription
+ * @param value the count of messages, 0 if it's limited by the capacity only
+ */
+void smart_shared_queue::durable_limit(const size_t value)
+{
+    boost::interprocess::ipcdetail::atomic_write32(reinterpret_cast<uint32_t*>(m_ptr + DURABLE_LIMIT_OFFSET), value);
+}
+
+/**
+ * Get the slots of durable subscriptions
+ * @return the slots of durable subscriptions
+ */
+smart_shared_queue::durable_slot_type *smart_shared_queue::slots() const
+{
+    return reinterpret_cast<durable_slot_type*>(m_ptr + SLOTS_OFFSET);
+}
+
+/**
+ * Attach the durable subscription
+ * @param name the name of the subscription
+ * @return true if the subscription existed and its position is restored,
+ * false if a new subscription has to be initialized
+ */
+bool smart_shared_queue::attach(const std::string& name)
+{
+    durable_slot_type *pslots = slots();
+    durable_slot_type *pfree = NULL;
+    for (size_t i = 0; i < SLOTS_COUNT; ++i)
+    {
+        durable_slot_type& slot = pslots[i];
+        if ('\0' == slot.name[0])
+        {
+            pfree = NULL == pfree ? &slot : pfree;
+        }
+        else if (0 == strncmp(slot.name, name.c_str(), sizeof(slot.name) - 1))
+        {
+            if (slot.sid != 0 && (0 == kill(slot.sid, 0) || EPERM == errno))
+            {
+                return false; // the subscription is used by a live process
+            }
+            slot.sid = qbus::message::get_sid();
+            m_pslot = &slot;
+            m_head = slot.head;
+            m_counter = slot.counter;
+            return true;
+        }
+    }
+    if (pfree != NULL)
+    {
+        strncpy(pfree->name, name.c_str(), sizeof(pfree->name) - 1);
+        pfree->name[sizeof(pfree->name) - 1] = '\0';
+        pfree->sid = qbus::message::get_sid();
+        m_pslot = pfree;
+    }
+    return false;
+}
+
+/**
+ * Save the position of the durable subscription
+ */
+void smart_shared_queue::save_position()
+{
+    if (m_pslot != NULL)
+    {
+        m_pslot->head = m_head;
+        m_pslot->counter = m_counter;
+    }
+}
+
+/**
+ * Release detached subscriptions that hold too many messages
+ * @param force if it's true then all detached subscriptions are released
+ * @return true if a subscription is released
+ */
+bool smart_shared_queue::release_durables(const bool force)
+{
+    const size_t limit = durable_limit();
+    durable_slot_type *pslots = slots();
+    bool result = false;
+    for (size_t i = 0; i < SLOTS_COUNT; ++i)
+    {
+        durable_slot_type& slot = pslots[i];
+        if (slot.name[0] != '\0' && 0 == slot.sid && 
+            (force || (limit > 0 && counter() - slot.counter > limit)))
+        {
+            release_durable(slot);
+            result = true;
+        }
+    }
+    return result;
+}
+
+/**
+ * Release the detached subscription, its references to messages are dropped
+ * @param slot the slot of the subscription
+ */
+void smart_shared_queue::release_durable(durable_slot_type& slot)
+{
+    rollback<pos_type> head(m_head);
+    rollback<uint32_t> counter(m_counter);
+    m_head = slot.head;
+    m_counter = slot.counter;
+    while (count() > 0)
+    {
+        const message_desc_type message_desc = base_shared_queue::get_message();
+        if (!message_desc.first)
+        {
+            break;
+        }
+        message_desc.first->dec_counter();
+        m_head = message_desc.second % capacity();
+        ++m_counter;
+    }
+    dec_subscriptions_count();
+    memset(&slot, 0, sizeof(slot));
+}
+
+/**
+ * Pop a message from the queue
+ * @param message_desc the description of the message
+ */
+//virtual 
+void smart_shared_queue::pop_message(const message_desc_type& message_desc)
+{
+    base_shared_queue::pop_message(message_desc);
+    save_position();
+}
+
 /**
  * Get the size of the queue
  * @return the size of the queue
@@ -983,12 +1472,59 @@ void smart_shared_queue::push_service_message(service_code_type code)
 //virtual
 smart_shared_queue::garbage_info_type smart_shared_queue::clean_messages()
 {
-    garbage_info_type garbage_info = base_shared_queue::clean_messages();
-    if (garbage_info.first > 0)
+    return collect_messages(false);
+}
+
+/**
+ * Collect garbage
+ * @param force if it's true then the retention window is ignored and
+ * the collecting stops after the first data message
+ * @return the information about collected garbage
+ */
+smart_shared_queue::garbage_info_type smart_shared_queue::collect_messages(const bool force)
+{
+    size_t cnt = base_queue::count();
+    if (cnt > 0)
     {
-        inc_free_space(garbage_info.second);
+        rollback<pos_type> head(m_head);
+        rollback<uint32_t> counter(m_counter);
+        m_head = pos_type(-1);
+        --m_counter;
+        const size_t now = qbus::message::get_timestamp();
+        size_t rest = data_count();
+        garbage_info_type garbage_info;
+        while (cnt-- > 0)
+        {
+            const message_desc_type message_desc = base_shared_queue::get_message();
+            if (!message_desc.first || message_desc.first->counter() > 0)
+            {
+                break;
+            }
+            const bool data = message_desc.first->tag() != service_message_type::TAG;
+            if (data && !force && retained(message_desc.first->timestamp(), rest, now))
+            {
+                break;
+            }
+            base_queue::head(message_desc.second);
+            base_queue::count(cnt);
+            ++garbage_info.first;
+            garbage_info.second += message_desc.first->total_size();
+            if (data)
+            {
+                data_count(--rest);
+                if (force)
+                {
+                    break;
+                }
+            }
+        }
+        if (garbage_info.first > 0)
+        {
+            inc_free_space(garbage_info.second);
+        }
+        return garbage_info;
     }
-    return garbage_info;
+    return garbage_info_type();
 }
 
 /**
@@ -1000,11 +1536,24 @@ smart_shared_queue::garbage_info_type smart_shared_queue::clean_messages()
 //virtual
 smart_shared_queue::message_desc_type smart_shared_queue::push_message(const void *data, const size_t size)
 {
+    if (durable_limit() > 0)
+    {
+        release_durables(false);
+    }
     message_desc_type message_desc = base_shared_queue::push_message(data, size);
+    while (!message_desc.first && 
+        (collect_messages(true).first > 0 || release_durables(true)))
+    {
+        message_desc = base_shared_queue::push_message(data, size);
+    }
     if (message_desc.first)
     {
         const size_t message_size = message_desc.first->total_size();
         dec_free_space(message_size);
+        if (m_state != ST_PUSH_SPECIAL_MESSAGE)
+        {
+            data_count(data_count() + 1);
+        }
     }
     return message_desc;
 }
@@ -6,6 +6,7 @@
 #include "qbus/service_message.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <string>
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 
@@ -36,12 +37,15 @@ public:
     bool pop(); ///< remove the next message
     id_type id() const; ///< get the identifier of the queue
     size_t capacity() const; ///< get the capacity of the queue
+    size_t usage() const; ///< get the size of the busy space of the queue
     size_t keepalive_timeout() const; ///< get the keep alive timeout
     void keepalive_timeout(const size_t value); ///< set the keep alive timeout
     virtual size_t count() const; ///< get the count of messages
     bool empty() const; ///< check the queue is empty 
     void clear(); ///< clear the queue
     size_t clean(); ///< collect garbage
+    size_t reclaim(); ///< return the memory pages of free regions to the OS
+    size_t repair(); ///< recount the messages after a crash of a writer
     virtual size_t size() const; ///< get the size of the queue
     static size_t static_size(const size_t cpct)
     {
@@ -72,9 +76,12 @@ protected:
     pos_type tail() const; /// get the tail of the queue
     void tail(const pos_type value); /// set the tail of the queue
     void count(const size_t value); ///< set the count of messages
+    size_t inc_count(); ///< increase the count of messages
+    size_t dec_count(); ///< reduce the count of messages
     void *data(const pos_type pos = 0) const; ///< get the pointer to data region of the queue
     virtual garbage_info_type clean_messages(); ///< collect garbage
     virtual message_desc_type push_message(const void *data, const size_t size) = 0; ///< push new message to the queue
+    virtual void commit_message(const message_desc_type& message_desc); ///< publish the pushed message to readers
     virtual message_desc_type get_message() const = 0; ///< get a message from the queue
     virtual void pop_message(const message_desc_type& message_desc) = 0; ///< pop a message from the queue
     virtual pmessage_type make_message(void *ptr, const size_t cpct) const = 0; ///< make an empty message
@@ -86,6 +93,7 @@ private:
     base_queue(const base_queue&);
     base_queue& operator=(const base_queue&);
     bool do_push(const tag_type tag, const void *data, const size_t sz); ///< push new message to the queue
+    size_t reclaim_region(const region_type& region) const; ///< return the memory pages of the region to the OS
     void capacity(const size_t capacity); ///< set the capacity of of the queue
 #ifdef QBUS_TEST_ENABLED    
     region_type get_real_busy_region(region_type *pprev_region = NULL) const; ///< get the real next busy region
@@ -151,6 +159,7 @@ protected:
     virtual pos_type head() const; /// get the head of the queue
     virtual garbage_info_type clean_messages(); ///< collect garbage
     virtual message_desc_type push_message(const void *data, const size_t size); ///< push new message to the queue
+    virtual void commit_message(const message_desc_type& message_desc); ///< publish the pushed message to readers
     virtual message_desc_type get_message() const; ///< get a message from the queue
     virtual void pop_message(const message_desc_type& message_desc); ///< pop a message from the queue
     virtual pmessage_type make_message(void *ptr, const size_t cpct) const; ///< make an empty message
@@ -226,10 +235,24 @@ class smart_shared_queue : public base_shared_queue
     typedef message::service_message<message_type> service_message_type;
     typedef service_message_type::code_type service_code_type;
 public:
+    enum join_type
+    {
+        JOIN_TAIL,      ///< start reading from the tail of the queue
+        JOIN_HISTORY    ///< start reading from the retention window of the queue
+    };
     explicit smart_shared_queue(void *ptr);
+    smart_shared_queue(void *ptr, const join_type join);
+    smart_shared_queue(void *ptr, const std::string& name, const join_type join = JOIN_TAIL);
     smart_shared_queue(const id_type qid, void *ptr, const size_t cpct);
     virtual ~smart_shared_queue();
     virtual size_t size() const; ///< get the size of the queue 
+    void retention(const size_t count, const size_t timeout); ///< set the retention window of the queue
+    size_t retention_count() const; ///< get the count of retained messages
+    size_t retention_timeout() const; ///< get the time while messages are retained
+    bool durable() const; ///< check if the subscription is durable
+    void unsubscribe(); ///< finish the durable subscription when the queue is destroyed
+    size_t durable_limit() const; ///< get the count of messages kept for a detached subscription
+    void durable_limit(const size_t value); ///< set the count of messages kept for a detached subscription
     static size_t static_size(const size_t cpct)
     {
         return HEADER_SIZE + base_shared_queue::static_size(cpct);
@@ -237,18 +260,50 @@ public:
 protected:
     smart_shared_queue(void *ptr, pqueue_type pqueue);
     smart_shared_queue(const id_type qid, void *ptr, const size_t cpct, pqueue_type pqueue);
+    /**
+     * The slot of a durable subscription
+     */
+    struct durable_slot_type
+    {
+        char name[32]; ///< the name of the subscription, empty if the slot is free
+        uint32_t sid; ///< the source identifier of the attached subscriber, 0 if it's detached
+        pos_type head; ///< the head of the subscriber
+        uint32_t counter; ///< the counter of popped messages of the subscriber
+    };
     enum
     {
-        FREE_SPACE_OFFSET = 0,
-        FREE_SPACE_SIZE   = sizeof(uint32_t),
-        HEADER_SIZE       = FREE_SPACE_OFFSET + FREE_SPACE_SIZE,
+        FREE_SPACE_OFFSET        = 0,
+        FREE_SPACE_SIZE          = sizeof(uint32_t),
+        DATA_COUNT_OFFSET        = FREE_SPACE_OFFSET + FREE_SPACE_SIZE,
+        DATA_COUNT_SIZE          = sizeof(uint32_t),
+        RETENTION_COUNT_OFFSET   = DATA_COUNT_OFFSET + DATA_COUNT_SIZE,
+        RETENTION_COUNT_SIZE     = sizeof(uint32_t),
+        RETENTION_TIMEOUT_OFFSET = RETENTION_COUNT_OFFSET + RETENTION_COUNT_SIZE,
+        RETENTION_TIMEOUT_SIZE   = sizeof(uint32_t),
+        DURABLE_LIMIT_OFFSET     = RETENTION_TIMEOUT_OFFSET + RETENTION_TIMEOUT_SIZE,
+        DURABLE_LIMIT_SIZE       = sizeof(uint32_t),
+        SLOTS_OFFSET             = DURABLE_LIMIT_OFFSET + DURABLE_LIMIT_SIZE,
+        SLOTS_COUNT              = 8,
+        SLOTS_SIZE               = SLOTS_COUNT * sizeof(durable_slot_type),
+        HEADER_SIZE              = SLOTS_OFFSET + SLOTS_SIZE
     };
-    void initialize(); ///< initialize the queue
+    void initialize(const join_type join = JOIN_TAIL); ///< initialize the queue
+    void join_history(); ///< move the head of the subscriber to the retention window
     size_t free_space() const; ///< get the free space of the queue
     void free_space(const size_t value); ///< set the free space of the queue
     size_t inc_free_space(const size_t value); ///< increase the free space of the queue
     size_t dec_free_space(const size_t value); ///< reduce the the free space of the queue
+    size_t data_count() const; ///< get the count of data messages in the queue
+    void data_count(const size_t value); ///< set the count of data messages in the queue
+    bool retained(const size_t timestamp, const size_t rest, const size_t now) const; ///< check if the message is in the retention window
+    garbage_info_type collect_messages(const bool force); ///< collect garbage
+    durable_slot_type *slots() const; ///< get the slots of durable subscriptions
+    bool attach(const std::string& name); ///< attach the durable subscription
+    void save_position(); ///< save the position of the durable subscription
+    bool release_durables(const bool force); ///< release detached subscriptions that hold too many messages
+    void release_durable(durable_slot_type& slot); ///< release the detached subscription
     virtual garbage_info_type clean_messages(); ///< collect garbage
+    virtual void pop_message(const message_desc_type& message_desc); ///< pop a message from the queue
     virtual message_desc_type push_message(const void *data, const size_t size); ///< push new message to the queue
     virtual message_desc_type get_message() const; ///< get a message from the queue
     void push_service_message(service_code_type code); ///< push a service message to the queue
@@ -261,6 +316,8 @@ private:
     };
     uint8_t *m_ptr; ///< the pointer to the raw queue
     state_type m_state; ///< the current state of the queue
+    durable_slot_type *m_pslot; ///< the slot of the durable subscription
+    bool m_unsubscribed; ///< the durable subscription is finished
 };
 
 template < >
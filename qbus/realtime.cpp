@@ -0,0 +1,181 @@
+#include "qbus/realtime.h"
+#include <assert.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <boost/interprocess/detail/atomic.hpp>
+
+namespace qbus
+{
+
+namespace realtime
+{
+
+/**
+ * Constructor
+ */
+settings_type::settings_type() :
+    cpu(-1),
+    priority(0),
+    lock_memory(false)
+{
+}
+
+/**
+ * Apply the settings to the calling thread
+ * @param settings the settings of the thread
+ * @return false if a setting isn't permitted
+ */
+bool pin(const settings_type& settings)
+{
+    if (settings.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        return false;
+    }
+    if (settings.cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(settings.cpu, &cpuset);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0)
+        {
+            return false;
+        }
+    }
+    if (settings.priority > 0)
+    {
+        struct sched_param param;
+        param.sched_priority = settings.priority;
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//==============================================================================
+//  consumer_loop
+//==============================================================================
+/**
+ * Constructor
+ * @param pconnector the connector the loop consumes
+ */
+consumer_loop::consumer_loop(const pconnector_type& pconnector) :
+    m_pconnector(pconnector),
+    m_running(false),
+    m_stopped(0),
+    m_count(0)
+{
+}
+
+/**
+ * Destructor
+ */
+//virtual
+consumer_loop::~consumer_loop()
+{
+    assert(!m_running);
+}
+
+/**
+ * Spawn the thread of the loop, the thread gets its affinity and its
+ * scheduling policy before it starts, so it never runs with other ones
+ * @param settings the settings of the thread
+ * @return false if the thread can't be spawned with the settings
+ */
+bool consumer_loop::start(const settings_type& settings)
+{
+    if (m_running)
+    {
+        return false;
+    }
+    if (settings.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        return false;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (settings.cpu >= 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(settings.cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+    }
+    if (settings.priority > 0)
+    {
+        struct sched_param param;
+        param.sched_priority = settings.priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    boost::interprocess::ipcdetail::atomic_write32(&m_stopped, 0);
+    m_running = 0 == pthread_create(&m_thread, &attr, routine, this);
+    pthread_attr_destroy(&attr);
+    return m_running;
+}
+
+/**
+ * Stop the loop and wait for its thread
+ */
+void consumer_loop::stop()
+{
+    if (m_running)
+    {
+        boost::interprocess::ipcdetail::atomic_write32(&m_stopped, 1);
+        pthread_join(m_thread, NULL);
+        m_running = false;
+    }
+}
+
+/**
+ * Check if the loop is running
+ * @return the result of the checking
+ */
+bool consumer_loop::running() const
+{
+    return m_running;
+}
+
+/**
+ * Get the count of handled messages
+ * @return the count of handled messages
+ */
+size_t consumer_loop::count() const
+{
+    return m_count;
+}
+
+/**
+ * The routine of the thread
+ * @param arg the loop
+ * @return NULL
+ */
+//static
+void *consumer_loop::routine(void *arg)
+{
+    reinterpret_cast<consumer_loop*>(arg)->run();
+    return NULL;
+}
+
+/**
+ * Run the loop
+ */
+void consumer_loop::run()
+{
+    while (0 == m_stopped)
+    {
+        const pmessage_type pmessage = m_pconnector->get();
+        if (pmessage)
+        {
+            do_handle(pmessage);
+            m_pconnector->pop();
+            ++m_count;
+        }
+    }
+}
+
+} //namespace realtime
+
+} //namespace qbus
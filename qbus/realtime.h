@@ -0,0 +1,62 @@
+#ifndef QBUS_REALTIME_H
+#define QBUS_REALTIME_H
+
+#include "qbus/connector.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+namespace qbus
+{
+
+namespace realtime
+{
+
+/**
+ * The settings of a real-time thread
+ */
+struct settings_type
+{
+    settings_type();
+    int cpu; ///< the CPU the thread is pinned to, -1 keeps the affinity
+    int priority; ///< the SCHED_FIFO priority, 0 keeps the scheduling policy
+    bool lock_memory; ///< lock all current and future pages of the process
+};
+
+bool pin(const settings_type& settings); ///< apply the settings to the calling thread
+
+/**
+ * The consumer loop that runs on its own thread with the real-time settings.
+ * It busy-polls the connector and never parks, so the data path doesn't
+ * depend on the scheduler latency. The derived class handles the messages
+ * and must stop the loop in its destructor.
+ */
+class consumer_loop
+{
+public:
+    explicit consumer_loop(const pconnector_type& pconnector);
+    virtual ~consumer_loop();
+    bool start(const settings_type& settings); ///< spawn the thread of the loop
+    void stop(); ///< stop the loop and wait for its thread
+    bool running() const; ///< check if the loop is running
+    size_t count() const; ///< get the count of handled messages
+protected:
+    virtual void do_handle(const pmessage_type& pmessage) = 0; ///< handle the message
+private:
+    consumer_loop(const consumer_loop& );
+    consumer_loop& operator=(const consumer_loop& );
+    static void *routine(void *arg); ///< the routine of the thread
+    void run(); ///< run the loop
+private:
+    const pconnector_type m_pconnector;
+    pthread_t m_thread;
+    bool m_running;
+    volatile uint32_t m_stopped; ///< the loop is requested to stop
+    volatile size_t m_count; ///< the count of handled messages
+};
+
+} //namespace realtime
+
+} //namespace qbus
+
+#endif /* QBUS_REALTIME_H */
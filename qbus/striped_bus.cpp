@@ -0,0 +1,406 @@
+#include "qbus/striped_bus.h"
+#include <string.h>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
+#include <boost/interprocess/detail/atomic.hpp>
+
+namespace qbus
+{
+
+namespace bus
+{
+
+//==============================================================================
+//  copied_message
+//==============================================================================
+/**
+ * The buffer of the copied message, it's a base of the message to be
+ * constructed before the message is placed in it
+ */
+struct message_buffer
+{
+    explicit message_buffer(const size_t size) :
+        m_buffer(message::base_message::static_size(size))
+    {}
+    std::vector<uint8_t> m_buffer;
+};
+
+/**
+ * The message that is copied out of a lane without its sequence, it gets
+ * the tag of the lane message, and the source and the time of the copying
+ */
+class copied_message : private message_buffer, public message::base_message
+{
+public:
+    copied_message(const tag_type value, const void *data, const size_t size) :
+        message_buffer(size),
+        message::base_message(&m_buffer[0], size)
+    {
+        tag(value);
+        pack(data, size);
+    }
+};
+
+//==============================================================================
+//  striped_bus
+//==============================================================================
+/**
+ * Constructor
+ * @param name the name of the bus
+ */
+striped_bus::striped_bus(const std::string& name) :
+    m_name(name),
+    m_lane(NO_LANE),
+    m_owner(false),
+    m_current(NO_LANE),
+    m_next(0)
+{
+}
+
+/**
+ * Destructor
+ */
+striped_bus::~striped_bus()
+{
+    close();
+}
+
+/**
+ * Get the name of the bus
+ * @return the name of the bus
+ */
+const std::string& striped_bus::name() const
+{
+    return m_name;
+}
+
+/**
+ * Create the bus, every lane is created with the specification, so it
+ * grows and shrinks on its own
+ * @param spec the specification of a lane
+ * @param lanes the count of lanes
+ * @param merge the merge of the lanes
+ * @return the result of the creating
+ */
+bool striped_bus::create(const specification_type& spec, const size_t lanes,
+    const merge_type merge)
+{
+    if (m_pmemory || 0 == lanes)
+    {
+        return false;
+    }
+    /* the lanes are created before the body, so the bus that is opened
+     * has all of them */
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        const pbus_type pbus = bus::make<lane_type>(lane_name(i));
+        if (!pbus->create(spec))
+        {
+            m_planes.clear();
+            return false;
+        }
+        m_planes.push_back(pbus);
+    }
+    m_pmemory = boost::make_shared<shared_memory_type>(m_name);
+    if (!m_pmemory->create(body_size(lanes)))
+    {
+        close();
+        return false;
+    }
+    striped_body& sb = body();
+    sb.merge = merge;
+    sb.sequence = 0;
+    boost::interprocess::ipcdetail::atomic_write32(&sb.lanes, lanes);
+    m_heads.resize(lanes);
+    return true;
+}
+
+/**
+ * Open the bus
+ * @return the result of the opening
+ */
+bool striped_bus::open()
+{
+    if (m_pmemory)
+    {
+        return false;
+    }
+    m_pmemory = boost::make_shared<shared_memory_type>(m_name);
+    if (m_pmemory->open() && m_pmemory->size() >= body_size(1))
+    {
+        const size_t lanes = boost::interprocess::ipcdetail::atomic_read32(&body().lanes);
+        if (lanes > 0 && m_pmemory->size() >= body_size(lanes) && open_lanes(lanes))
+        {
+            return true;
+        }
+    }
+    close();
+    return false;
+}
+
+/**
+ * Close the bus, the claimed lane is released
+ */
+void striped_bus::close()
+{
+    if (m_owner)
+    {
+        boost::interprocess::ipcdetail::atomic_write32(&body().owners[m_lane], 0);
+        m_owner = false;
+    }
+    m_lane = NO_LANE;
+    m_current = NO_LANE;
+    m_next = 0;
+    m_heads.clear();
+    m_planes.clear();
+    m_pmemory.reset();
+}
+
+/**
+ * Join the lane of a group of producers instead of claiming a free one
+ * @param lane the lane
+ * @return false if there isn't the lane
+ */
+bool striped_bus::join(const size_t lane)
+{
+    if (lane >= m_planes.size())
+    {
+        return false;
+    }
+    if (m_owner)
+    {
+        boost::interprocess::ipcdetail::atomic_write32(&body().owners[m_lane], 0);
+        m_owner = false;
+    }
+    m_lane = lane;
+    return true;
+}
+
+/**
+ * Push data to the lane of the producer
+ * @param tag the tag of the data
+ * @param data the data
+ * @param size the size of the data
+ * @return result of the pushing
+ */
+bool striped_bus::push(const tag_type tag, const void *data, const size_t size)
+{
+    if (m_planes.empty())
+    {
+        return false;
+    }
+    if (NO_LANE == m_lane)
+    {
+        m_lane = claim();
+    }
+    if (MERGE_UNORDERED == merge())
+    {
+        return m_planes[m_lane]->push(tag, data, size);
+    }
+    const uint32_t sequence = boost::interprocess::ipcdetail::atomic_inc32(&body().sequence);
+    m_buffer.resize(sizeof(sequence) + size);
+    memcpy(&m_buffer[0], &sequence, sizeof(sequence));
+    if (size > 0)
+    {
+        memcpy(&m_buffer[sizeof(sequence)], data, size);
+    }
+    return m_planes[m_lane]->push(tag, &m_buffer[0], m_buffer.size());
+}
+
+/**
+ * Get the next message from the bus
+ * @return the message
+ */
+const pmessage_type striped_bus::get() const
+{
+    if (m_planes.empty())
+    {
+        return pmessage_type();
+    }
+    return MERGE_UNORDERED == merge() ? get_unordered() : get_ordered();
+}
+
+/**
+ * Remove the message that is got last from the bus
+ * @return the result of the removing
+ */
+bool striped_bus::pop()
+{
+    if (NO_LANE == m_current && !get())
+    {
+        return false;
+    }
+    const size_t lane = m_current;
+    if (m_planes[lane]->pop())
+    {
+        if (lane < m_heads.size())
+        {
+            m_heads[lane].pmessage.reset();
+        }
+        m_current = NO_LANE;
+        m_next = (lane + 1) % m_planes.size();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Get the count of lanes
+ * @return the count of lanes
+ */
+size_t striped_bus::lanes() const
+{
+    return m_planes.size();
+}
+
+/**
+ * Get the merge of the lanes
+ * @return the merge of the lanes
+ */
+merge_type striped_bus::merge() const
+{
+    return m_pmemory ? static_cast<merge_type>(body().merge) : MERGE_UNORDERED;
+}
+
+/**
+ * Set the growth policy of the lanes
+ * @param ppolicy the growth policy
+ */
+void striped_bus::policy(const pgrowth_policy_type& ppolicy)
+{
+    for (size_t i = 0; i < m_planes.size(); ++i)
+    {
+        m_planes[i]->policy(ppolicy);
+    }
+}
+
+/**
+ * Get the size of the body
+ * @param lanes the count of lanes
+ * @return the size of the body
+ */
+//static
+size_t striped_bus::body_size(const size_t lanes)
+{
+    return sizeof(striped_body) + (lanes - 1) * sizeof(uint32_t);
+}
+
+/**
+ * Get the name of the lane, the dot keeps the names of the connectors of
+ * a lane apart from the names of other lanes
+ * @param lane the lane
+ * @return the name of the lane
+ */
+std::string striped_bus::lane_name(const size_t lane) const
+{
+    return m_name + "_lane" + boost::lexical_cast<std::string>(lane) + ".";
+}
+
+/**
+ * Get the body of the bus
+ * @return the body of the bus
+ */
+striped_bus::striped_body& striped_bus::body() const
+{
+    return *reinterpret_cast<striped_body*>(m_pmemory->get());
+}
+
+/**
+ * Open the lanes
+ * @param lanes the count of lanes
+ * @return the result of the opening
+ */
+bool striped_bus::open_lanes(const size_t lanes)
+{
+    for (size_t i = 0; i < lanes; ++i)
+    {
+        const pbus_type pbus = bus::make<lane_type>(lane_name(i));
+        if (!pbus->open())
+        {
+            m_planes.clear();
+            return false;
+        }
+        m_planes.push_back(pbus);
+    }
+    m_heads.resize(lanes);
+    return true;
+}
+
+/**
+ * Claim a free lane for pushing, the producer that finds all lanes claimed
+ * shares the lane of its source identifier
+ * @return the lane
+ */
+size_t striped_bus::claim()
+{
+    striped_body& sb = body();
+    for (size_t i = 0; i < m_planes.size(); ++i)
+    {
+        if (0 == boost::interprocess::ipcdetail::atomic_cas32(&sb.owners[i], 1, 0))
+        {
+            m_owner = true;
+            return i;
+        }
+    }
+    return message::get_sid() % m_planes.size();
+}
+
+/**
+ * Get the message with the lowest sequence among the heads of the lanes,
+ * the head of a lane is copied once and is kept until it's popped
+ * @return the message
+ */
+const pmessage_type striped_bus::get_ordered() const
+{
+    m_current = NO_LANE;
+    for (size_t i = 0; i < m_planes.size(); ++i)
+    {
+        head_type& head = m_heads[i];
+        if (!head.pmessage)
+        {
+            const pmessage_type pmessage = m_planes[i]->get();
+            if (!pmessage)
+            {
+                continue;
+            }
+            const size_t size = pmessage->data_size();
+            m_buffer.assign(std::max(size, sizeof(head.sequence)), 0);
+            pmessage->unpack(&m_buffer[0]);
+            memcpy(&head.sequence, &m_buffer[0], sizeof(head.sequence));
+            const size_t data_size = size - std::min(size, sizeof(head.sequence));
+            head.pmessage = boost::make_shared<copied_message>(pmessage->tag(),
+                &m_buffer[0] + sizeof(head.sequence), data_size);
+        }
+        if (NO_LANE == m_current ||
+            static_cast<int32_t>(head.sequence - m_heads[m_current].sequence) < 0)
+        {
+            m_current = i;
+        }
+    }
+    return NO_LANE != m_current ? m_heads[m_current].pmessage : pmessage_type();
+}
+
+/**
+ * Get the message of the next lane that isn't empty, the lanes are polled
+ * in turn starting after the lane of the last popped message
+ * @return the message
+ */
+const pmessage_type striped_bus::get_unordered() const
+{
+    for (size_t i = 0; i < m_planes.size(); ++i)
+    {
+        const size_t lane = (m_next + i) % m_planes.size();
+        const pmessage_type pmessage = m_planes[lane]->get();
+        if (pmessage)
+        {
+            m_current = lane;
+            return pmessage;
+        }
+    }
+    m_current = NO_LANE;
+    return pmessage_type();
+}
+
+} //namespace bus
+
+} //namespace qbus
@@ -0,0 +1,96 @@
+#ifndef QBUS_STRIPED_BUS_H
+#define QBUS_STRIPED_BUS_H
+
+#include "qbus/bus.h"
+#include "qbus/memory.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace qbus
+{
+
+namespace bus
+{
+
+/**
+ * The merge of the lanes of a striped bus
+ */
+enum merge_type
+{
+    MERGE_UNORDERED = 0, ///< the lanes are polled in turn, the messages of a lane keep their order
+    MERGE_ORDERED   = 1  ///< the messages are got in the order of the global sequence of pushes
+};
+
+/**
+ * The striped bus. Every producer writes its own lane, which is a bus with
+ * its own connectors, lockers and growth, so producers never contend on
+ * a push. A producer claims a free lane on its first push, the producers
+ * that find all lanes claimed share them by their source identifiers.
+ * The consumer merges the lanes: the unordered merge polls them in turn,
+ * the ordered one stamps each push with the global sequence number and
+ * gets the lowest sequence among the heads of the lanes. A push that is
+ * in progress during the merge may be got after a later sequence. A bus
+ * has one consumer, since the consumer keeps the heads of the lanes.
+ */
+class striped_bus
+{
+public:
+    typedef qbus::single_bidirectional_bus_type lane_type;
+    explicit striped_bus(const std::string& name);
+    ~striped_bus();
+    const std::string& name() const; ///< get the name of the bus
+    bool create(const specification_type& spec, const size_t lanes, const merge_type merge); ///< create the bus
+    bool open(); ///< open the bus
+    void close(); ///< close the bus
+    bool join(const size_t lane); ///< join the lane of a group of producers
+    bool push(const tag_type tag, const void *data, const size_t size); ///< push data to the bus
+    const pmessage_type get() const; ///< get the next message from the bus
+    bool pop(); ///< remove the next message from the bus
+    size_t lanes() const; ///< get the count of lanes
+    merge_type merge() const; ///< get the merge of the lanes
+    void policy(const pgrowth_policy_type& ppolicy); ///< set the growth policy of the lanes
+private:
+    enum
+    {
+        NO_LANE = size_t(-1)
+    };
+    struct striped_body
+    {
+        uint32_t lanes; ///< the count of lanes
+        uint32_t merge; ///< the merge of the lanes
+        uint32_t sequence; ///< the global sequence of pushes, it wraps
+        uint32_t owners[1]; ///< the lanes claimed by producers, `lanes` items
+    };
+    struct head_type
+    {
+        pmessage_type pmessage; ///< the copy of the message without its sequence
+        uint32_t sequence; ///< the sequence of the message
+    };
+    striped_bus(const striped_bus& );
+    striped_bus& operator=(const striped_bus& );
+    static size_t body_size(const size_t lanes); ///< get the size of the body
+    std::string lane_name(const size_t lane) const; ///< get the name of the lane
+    striped_body& body() const; ///< get the body of the bus
+    bool open_lanes(const size_t lanes); ///< open the lanes
+    size_t claim(); ///< claim a lane for pushing
+    const pmessage_type get_ordered() const; ///< get the message with the lowest sequence
+    const pmessage_type get_unordered() const; ///< get the message of the next lane
+private:
+    const std::string m_name;
+    pshared_memory_type m_pmemory;
+    std::vector<pbus_type> m_planes;
+    mutable std::vector<head_type> m_heads; ///< the heads of the lanes for the ordered merge
+    mutable std::vector<uint8_t> m_buffer; ///< the buffer of a stamped message
+    size_t m_lane; ///< the lane of the producer
+    bool m_owner; ///< the lane is claimed by the producer
+    mutable size_t m_current; ///< the lane of the got message
+    mutable size_t m_next; ///< the lane the unordered merge polls first
+};
+
+} //namespace bus
+
+} //namespace qbus
+
+#endif /* QBUS_STRIPED_BUS_H */
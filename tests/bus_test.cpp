@@ -4,6 +4,9 @@
 
 #include "qbus/bus.h"
 #include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/lexical_cast.hpp>
 
 typedef std::vector<uint8_t> buffer_t;
 
@@ -214,3 +217,238 @@ BOOST_AUTO_TEST_CASE(overflow_test3)
 }
 
 
+
+static size_t allocated_size(const char *name)
+{
+    struct stat st;
+    BOOST_REQUIRE_EQUAL(stat((std::string("/dev/shm/") + name).c_str(), &st), 0);
+    return st.st_blocks * 512;
+}
+
+BOOST_AUTO_TEST_CASE(reclaim_test)
+{
+    pbus_type pbus1 = bus::make<single_output_bus_type>("test");
+    pbus_type pbus2 = bus::make<single_input_bus_type>("test");
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.keepalive_timeout = 0;
+    spec.min_capacity = 64 * 4096;
+    spec.max_capacity = 64 * 4096;
+    spec.capacity_factor = 0;
+    BOOST_REQUIRE(pbus1->create(spec));
+    BOOST_REQUIRE(pbus2->open());
+    buffer_t buffer = make_buffer(1024);
+    size_t count = 0;
+    while (pbus1->push(0, &buffer[0], buffer.size()))
+    {
+        ++count;
+    }
+    BOOST_REQUIRE(count > 0);
+    BOOST_REQUIRE(allocated_size("test0") >= spec.min_capacity);
+    while (count-- > 0)
+    {
+        BOOST_REQUIRE(pbus2->get());
+        BOOST_REQUIRE(pbus2->pop());
+    }
+    BOOST_REQUIRE(pbus2->reclaim() >= spec.min_capacity - 2 * 4096);
+    BOOST_REQUIRE(allocated_size("test0") <= 3 * 4096);
+    BOOST_REQUIRE(pbus1->push(0, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(pbus2->get());
+    BOOST_REQUIRE(pbus2->pop());
+}
+
+static bool exists(const char *name)
+{
+    struct stat st;
+    return 0 == stat((std::string("/dev/shm/") + name).c_str(), &st);
+}
+
+BOOST_AUTO_TEST_CASE(spare_test)
+{
+    pbus_type pbus1 = bus::make<single_output_bus_type>("spare");
+    pbus_type pbus2 = bus::make<single_input_bus_type>("spare");
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.min_capacity = 8 * 512;
+    spec.max_capacity = 64 * 512;
+    spec.capacity_factor = 50;
+    spec.spare_count = 2;
+    BOOST_REQUIRE(pbus1->create(spec));
+    BOOST_REQUIRE(pbus2->open());
+    BOOST_REQUIRE(allocated_size("spare1") >= 12 * 512);
+    BOOST_REQUIRE(allocated_size("spare2") >= 18 * 512);
+    BOOST_REQUIRE(!exists("spare3"));
+    BOOST_REQUIRE_EQUAL(pbus1->refill(), 0);
+    buffer_t buffer = make_buffer(512);
+    const size_t count = 10;
+    for (size_t i = 0; i < count; ++i)
+    {
+        BOOST_REQUIRE(pbus1->push(i, &buffer[0], buffer.size()));
+    }
+    BOOST_REQUIRE(!exists("spare3"));
+    for (size_t i = 0; i < count; ++i)
+    {
+        pmessage_type pmessage = pbus2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pbus2->pop());
+    }
+    BOOST_REQUIRE(!pbus2->get());
+    /* the consumer tops the spares up after the bus grows */
+    BOOST_REQUIRE(exists("spare3"));
+    BOOST_REQUIRE_EQUAL(pbus1->refill(), 1);
+    for (size_t i = 0; i < 4 * count; ++i)
+    {
+        BOOST_REQUIRE(pbus1->push(i, &buffer[0], buffer.size()));
+    }
+    for (size_t i = 0; i < 4 * count; ++i)
+    {
+        pmessage_type pmessage = pbus2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pbus2->pop());
+    }
+    BOOST_REQUIRE(!pbus2->get());
+}
+
+static size_t last_segment(const char *name, size_t& size)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < 32; ++i)
+    {
+        struct stat st;
+        if (0 == stat((std::string("/dev/shm/") + name + boost::lexical_cast<std::string>(i)).c_str(), &st))
+        {
+            result = i;
+            size = st.st_size;
+        }
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(shrink_test)
+{
+    pbus_type pbus1 = bus::make<single_output_bus_type>("shrink");
+    pbus_type pbus2 = bus::make<single_input_bus_type>("shrink");
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.min_capacity = 8 * 512;
+    spec.max_capacity = 64 * 512;
+    spec.capacity_factor = 50;
+    spec.shrink_threshold = 25;
+    spec.shrink_timeout = 1;
+    BOOST_REQUIRE(pbus1->create(spec));
+    BOOST_REQUIRE(pbus2->open());
+    buffer_t buffer = make_buffer(512);
+    size_t tag = 0;
+    for (; tag < 24; ++tag)
+    {
+        BOOST_REQUIRE(pbus1->push(tag, &buffer[0], buffer.size()));
+    }
+    size_t size = 0;
+    const size_t grown_id = last_segment("shrink", size);
+    BOOST_REQUIRE(grown_id > 1);
+    for (size_t i = 0; i < tag; ++i)
+    {
+        pmessage_type pmessage = pbus2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pbus2->pop());
+    }
+    /* the load must stay low for the timeout */
+    BOOST_REQUIRE(pbus1->push(tag++, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(pbus1->push(tag++, &buffer[0], buffer.size()));
+    size_t last_size = 0;
+    BOOST_REQUIRE_EQUAL(last_segment("shrink", last_size), grown_id);
+    usleep(1100000);
+    BOOST_REQUIRE(pbus1->push(tag++, &buffer[0], buffer.size()));
+    BOOST_REQUIRE_EQUAL(last_segment("shrink", last_size), grown_id + 1);
+    BOOST_REQUIRE(last_size < size);
+    BOOST_REQUIRE(pbus1->push(tag++, &buffer[0], buffer.size()));
+    for (size_t i = 24; i < tag; ++i)
+    {
+        pmessage_type pmessage = pbus2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pbus2->pop());
+    }
+    BOOST_REQUIRE(!pbus2->get());
+}
+
+BOOST_AUTO_TEST_CASE(rate_policy_test)
+{
+    bus::specification_type spec;
+    spec.min_capacity = 4096;
+    spec.max_capacity = 1024 * 1024;
+    spec.capacity_factor = 50;
+    bus::rate_growth_policy policy(100, 10);
+    bus::load_type load;
+    load.capacity = 8192;
+    load.usage = 8192;
+    load.backlog = 8192;
+    BOOST_REQUIRE_EQUAL(policy.next_capacity(spec, load), 12288);
+    BOOST_REQUIRE(!policy.grow_ahead(spec, load));
+    load.in_rate = 1000000;
+    BOOST_REQUIRE_EQUAL(policy.next_capacity(spec, load), 100000);
+    /* the consumer drains the backlog, then the new connector */
+    load.out_rate = 500000;
+    BOOST_REQUIRE_EQUAL(policy.next_capacity(spec, load), 100000 - (50000 - 8192));
+    load.in_rate = 20000000;
+    BOOST_REQUIRE_EQUAL(policy.next_capacity(spec, load), spec.max_capacity);
+    /* the peak fits the output connector, the next one still grows */
+    load.in_rate = 10000;
+    BOOST_REQUIRE_EQUAL(policy.next_capacity(spec, load), 12288);
+    load.in_rate = 1000000;
+    load.usage = 4096;
+    load.backlog = 4096;
+    BOOST_REQUIRE(policy.grow_ahead(spec, load));
+    load.backlog = 8192;
+    BOOST_REQUIRE(policy.grow_ahead(spec, load));
+    load.backlog = 4096;
+    load.out_rate = 1000000;
+    BOOST_REQUIRE(!policy.grow_ahead(spec, load));
+    load.out_rate = 990000;
+    BOOST_REQUIRE(!policy.grow_ahead(spec, load));
+}
+
+class triple_growth_policy : public bus::growth_policy
+{
+public:
+    //virtual
+    bus::size_type next_capacity(const bus::specification_type& , const bus::load_type& load) const
+    {
+        return 3 * load.capacity;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(growth_policy_test)
+{
+    pbus_type pbus1 = bus::make<single_output_bus_type>("growth");
+    pbus_type pbus2 = bus::make<single_input_bus_type>("growth");
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.min_capacity = 8 * 512;
+    spec.max_capacity = 64 * 512;
+    spec.capacity_factor = 50;
+    BOOST_REQUIRE(pbus1->create(spec));
+    BOOST_REQUIRE(pbus2->open());
+    pbus1->policy(boost::make_shared<triple_growth_policy>());
+    buffer_t buffer = make_buffer(512);
+    const size_t count = 12;
+    for (size_t i = 0; i < count; ++i)
+    {
+        BOOST_REQUIRE(pbus1->push(i, &buffer[0], buffer.size()));
+    }
+    size_t size1 = 0;
+    BOOST_REQUIRE_EQUAL(last_segment("growth", size1), 1);
+    struct stat st;
+    BOOST_REQUIRE_EQUAL(stat("/dev/shm/growth0", &st), 0);
+    BOOST_REQUIRE_EQUAL(size1 - st.st_size, 2 * spec.min_capacity);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pmessage_type pmessage = pbus2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pbus2->pop());
+    }
+}
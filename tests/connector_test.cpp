@@ -4,6 +4,10 @@
 
 #include "qbus/connector.h"
 #include <vector>
+#include <boost/thread.hpp>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 typedef std::vector<uint8_t> buffer_t;
 
@@ -45,3 +49,463 @@ BOOST_AUTO_TEST_CASE(simple_test)
     BOOST_REQUIRE(!pmessage);
 }
 
+static size_t allocated_size(const char *name)
+{
+    struct stat st;
+    BOOST_REQUIRE_EQUAL(stat((std::string("/dev/shm/") + name).c_str(), &st), 0);
+    return st.st_blocks * 512;
+}
+
+BOOST_AUTO_TEST_CASE(reclaim_test)
+{
+    const size_t capacity = 64 * 4096;
+    pconnector_type pconnector1 = connector::make<single_output_connector_type>("test");
+    pconnector_type pconnector2 = connector::make<single_input_connector_type>("test");
+    BOOST_REQUIRE(pconnector1->create(0, capacity));
+    BOOST_REQUIRE(pconnector2->open());
+    buffer_t buffer = make_buffer(1024);
+    size_t count = 0;
+    while (pconnector1->push(0, &buffer[0], buffer.size()))
+    {
+        ++count;
+    }
+    BOOST_REQUIRE(count > 0);
+    BOOST_REQUIRE(allocated_size("test") >= capacity);
+    BOOST_REQUIRE(pconnector1->reclaim() < 2 * 4096);
+    BOOST_REQUIRE(allocated_size("test") >= capacity);
+    while (count-- > 0)
+    {
+        BOOST_REQUIRE(pconnector2->get());
+        BOOST_REQUIRE(pconnector2->pop());
+    }
+    BOOST_REQUIRE(pconnector2->reclaim() >= capacity - 2 * 4096);
+    BOOST_REQUIRE(allocated_size("test") <= 3 * 4096);
+    BOOST_REQUIRE(pconnector1->push(0, &buffer[0], buffer.size()));
+    pmessage_type pmessage = pconnector2->get();
+    BOOST_REQUIRE(pmessage);
+    buffer_t data(pmessage->data_size());
+    pmessage->unpack(&data[0]);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(buffer.begin(), buffer.end(),
+        data.begin(), data.end());
+    BOOST_REQUIRE(pconnector2->pop());
+}
+
+struct file_remove
+{
+    explicit file_remove(const char *name) :
+        m_name(name)
+    {
+        memory::mapped_file::remove(m_name);
+    }
+    ~file_remove()
+    {
+        memory::mapped_file::remove(m_name);
+    }
+    const char *m_name;
+};
+
+BOOST_AUTO_TEST_CASE(persistent_test)
+{
+    const char *name = "persistent_test.qbus";
+    file_remove remover(name);
+    buffer_t buffer = make_buffer(512);
+    {
+        pconnector_type pconnector = connector::make<persistent_single_output_connector_type>(name);
+        BOOST_REQUIRE(pconnector->create(0, 32 * 512));
+        for (size_t i = 0; i < 3; ++i)
+        {
+            BOOST_REQUIRE(pconnector->push(i, &buffer[0], buffer.size()));
+        }
+        BOOST_REQUIRE(pconnector->flush());
+    }
+    {
+        pconnector_type pconnector = connector::make<persistent_single_output_connector_type>(name);
+        BOOST_REQUIRE(!pconnector->create(0, 32 * 512));
+    }
+    {
+        pconnector_type pconnector = connector::make<persistent_single_input_connector_type>(name);
+        BOOST_REQUIRE(pconnector->open());
+        pmessage_type pmessage = pconnector->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), 0);
+        BOOST_REQUIRE(pconnector->pop());
+    }
+    {
+        pconnector_type pconnector = connector::make<persistent_single_input_connector_type>(name);
+        BOOST_REQUIRE(pconnector->open());
+        for (size_t i = 1; i < 3; ++i)
+        {
+            pmessage_type pmessage = pconnector->get();
+            BOOST_REQUIRE(pmessage);
+            BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+            buffer_t data(pmessage->data_size());
+            pmessage->unpack(&data[0]);
+            BOOST_REQUIRE_EQUAL_COLLECTIONS(buffer.begin(), buffer.end(),
+                data.begin(), data.end());
+            BOOST_REQUIRE(pconnector->pop());
+        }
+        BOOST_REQUIRE(!pconnector->get());
+    }
+}
+
+/**
+ * The persistent connector that dies while it holds its locker
+ */
+class crashed_connector : public persistent_single_output_connector_type
+{
+public:
+    explicit crashed_connector(const std::string& name) :
+        persistent_single_output_connector_type(name)
+    {}
+    void crash()
+    {
+        locker().lock();
+        _exit(0);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(persistent_crash_test)
+{
+    const char *name = "persistent_crash_test.qbus";
+    file_remove remover(name);
+    buffer_t buffer = make_buffer(512);
+    const pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (0 == pid)
+    {
+        crashed_connector connector(name);
+        if (connector.create(0, 32 * 512) &&
+            connector.push(1, &buffer[0], buffer.size()))
+        {
+            connector.crash();
+        }
+        _exit(1);
+    }
+    int status = -1;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_REQUIRE(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+    pconnector_type pconnector1 = connector::make<persistent_single_input_connector_type>(name);
+    BOOST_REQUIRE(pconnector1->open());
+    pconnector_type pconnector2 = connector::make<persistent_single_output_connector_type>(name);
+    BOOST_REQUIRE(pconnector2->open());
+    BOOST_REQUIRE(pconnector2->push(2, &buffer[0], buffer.size()));
+    for (size_t i = 1; i < 3; ++i)
+    {
+        pmessage_type pmessage = pconnector1->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pconnector1->pop());
+    }
+    BOOST_REQUIRE(!pconnector1->get());
+}
+
+typedef connector::safe_connector<
+    connector::bidirectional_connector<connector::single_bidirectional_connector_type>,
+    connector::sharable_futexlocker_with_sharable_pop_interface> futex_connector_type;
+
+static void push_later(pconnector_type pconnector, const buffer_t& buffer)
+{
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    pconnector->push(1, &buffer[0], buffer.size());
+}
+
+BOOST_AUTO_TEST_CASE(futex_barrier_test)
+{
+    pconnector_type pconnector1 = connector::make<futex_connector_type>("futex_barrier_test");
+    pconnector_type pconnector2 = connector::make<futex_connector_type>("futex_barrier_test");
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    const struct timespec timeout = {0, 20000000};
+    const struct timespec start = get_monotonic_time();
+    BOOST_REQUIRE(!pconnector2->get(timeout));
+    BOOST_REQUIRE(get_monotonic_time() - start >= timeout);
+    buffer_t buffer = make_buffer(512);
+    BOOST_REQUIRE(pconnector1->push(0, &buffer[0], buffer.size()));
+    const struct timespec long_timeout = {5, 0};
+    pmessage_type pmessage = pconnector2->get(long_timeout);
+    BOOST_REQUIRE(pmessage);
+    BOOST_REQUIRE_EQUAL(pmessage->tag(), 0);
+    BOOST_REQUIRE(pconnector2->pop());
+    boost::thread thread(push_later, pconnector1, boost::cref(buffer));
+    pmessage = pconnector2->get(long_timeout);
+    thread.join();
+    BOOST_REQUIRE(pmessage);
+    BOOST_REQUIRE_EQUAL(pmessage->tag(), 1);
+    BOOST_REQUIRE(get_monotonic_time() - start < long_timeout);
+}
+
+static void pop_later(pconnector_type pconnector)
+{
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    pconnector->pop();
+}
+
+static struct timespec get_thread_time()
+{
+    struct timespec ts = {0, 0};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts;
+}
+
+BOOST_AUTO_TEST_CASE(blocking_push_test)
+{
+    pconnector_type pconnector1 = connector::make<futex_connector_type>("blocking_push_test");
+    pconnector_type pconnector2 = connector::make<futex_connector_type>("blocking_push_test");
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    buffer_t buffer = make_buffer(512);
+    size_t count = 0;
+    while (pconnector1->push(count, &buffer[0], buffer.size()))
+    {
+        ++count;
+    }
+    BOOST_REQUIRE(count > 0);
+    const struct timespec timeout = {0, 20000000};
+    BOOST_REQUIRE(!pconnector1->push(count, &buffer[0], buffer.size(), timeout));
+    boost::thread thread(pop_later, pconnector2);
+    const struct timespec long_timeout = {5, 0};
+    const struct timespec start = get_monotonic_time();
+    const struct timespec start_cpu = get_thread_time();
+    BOOST_REQUIRE(pconnector1->push(count, &buffer[0], buffer.size(), long_timeout));
+    const struct timespec cpu = get_thread_time() - start_cpu;
+    const struct timespec elapsed = get_monotonic_time() - start;
+    thread.join();
+    BOOST_REQUIRE(elapsed < long_timeout);
+    /* the producer sleeps while the queue is full */
+    BOOST_REQUIRE(cpu + cpu < elapsed);
+    for (size_t i = 1; i <= count; ++i)
+    {
+        pmessage_type pmessage = pconnector2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pconnector2->pop());
+    }
+    BOOST_REQUIRE(!pconnector2->get());
+}
+
+template <typename Connector>
+static void check_timed_operations(const std::string& name)
+{
+    pconnector_type pconnector1 = connector::make<Connector>(name);
+    pconnector_type pconnector2 = connector::make<Connector>(name);
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    const struct timespec timeout = {0, 10000000};
+    const struct timespec start = get_monotonic_time();
+    BOOST_REQUIRE(!pconnector2->get(timeout));
+    BOOST_REQUIRE(!pconnector2->pop(timeout));
+    BOOST_REQUIRE(get_monotonic_time() - start >= timeout + timeout);
+    buffer_t buffer = make_buffer(512);
+    BOOST_REQUIRE(pconnector1->push(0, &buffer[0], buffer.size(), timeout));
+    pmessage_type pmessage = pconnector2->get(timeout);
+    BOOST_REQUIRE(pmessage);
+    BOOST_REQUIRE_EQUAL(pmessage->tag(), 0);
+    BOOST_REQUIRE(pconnector2->pop(timeout));
+    size_t count = 0;
+    while (pconnector1->push(count + 1, &buffer[0], buffer.size(), timeout))
+    {
+        ++count;
+    }
+    BOOST_REQUIRE(count > 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pmessage = pconnector2->get(timeout);
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i + 1);
+        BOOST_REQUIRE(pconnector2->pop(timeout));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(wait_strategy_test)
+{
+    typedef connector::bidirectional_connector<
+        connector::single_bidirectional_connector_type> connector_type;
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::sharable_locker_interface, busy_spin_wait> >("wait_strategy_test1");
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::sharable_locker_interface, spin_yield_wait> >("wait_strategy_test2");
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::sharable_futexlocker_interface, busy_spin_wait> >("wait_strategy_test3");
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::sharable_futexlocker_interface, spin_yield_wait> >("wait_strategy_test4");
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::sharable_futexlocker_interface, spin_park_wait> >("wait_strategy_test5");
+}
+
+BOOST_AUTO_TEST_CASE(fair_locker_test)
+{
+    typedef connector::bidirectional_connector<
+        connector::single_bidirectional_connector_type> connector_type;
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::sharable_fairlocker_interface> >("fair_locker_test");
+}
+
+BOOST_AUTO_TEST_CASE(pi_locker_test)
+{
+    typedef connector::bidirectional_connector<
+        connector::single_bidirectional_connector_type> connector_type;
+    check_timed_operations<connector::safe_connector<connector_type,
+        connector::pi_locker_interface, busy_spin_wait> >("pi_locker_test");
+}
+
+static void push_messages(pconnector_type pconnector, const size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t value = i;
+        while (!pconnector->push(i, &value, sizeof(value)))
+        {
+            boost::this_thread::yield();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(optimistic_get_test)
+{
+    pconnector_type pconnector1 = connector::make<single_output_connector_type>("optimistic_get_test");
+    pconnector_type pconnector2 = connector::make<single_input_connector_type>("optimistic_get_test");
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 64));
+    BOOST_REQUIRE(pconnector2->open());
+    BOOST_REQUIRE(!pconnector2->get());
+    const size_t count = 20000;
+    boost::thread thread(push_messages, pconnector1, count);
+    size_t i = 0;
+    while (i < count)
+    {
+        pmessage_type pmessage = pconnector2->get();
+        if (!pmessage)
+        {
+            continue;
+        }
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        uint32_t value = 0;
+        pmessage->unpack(&value);
+        BOOST_REQUIRE_EQUAL(value, i);
+        BOOST_REQUIRE(pconnector2->pop());
+        ++i;
+    }
+    thread.join();
+    BOOST_REQUIRE(!pconnector2->get());
+}
+
+static void push_variable_messages(pconnector_type pconnector, const size_t count)
+{
+    buffer_t buffer(512);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t size = 1 + i * 37 % buffer.size();
+        for (size_t k = 0; k < size; ++k)
+        {
+            buffer[k] = i + k;
+        }
+        while (!pconnector->push(i, &buffer[0], size))
+        {
+            boost::this_thread::yield();
+        }
+    }
+}
+
+template <typename Producer, typename Consumer>
+static void check_dual_locker(const std::string& name)
+{
+    pconnector_type pconnector1 = connector::make<Producer>(name);
+    pconnector_type pconnector2 = connector::make<Consumer>(name);
+    BOOST_REQUIRE(pconnector1->create(0, 8 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    const size_t count = 5000;
+    boost::thread thread(push_variable_messages, pconnector1, count);
+    buffer_t buffer(512);
+    size_t i = 0;
+    while (i < count)
+    {
+        pmessage_type pmessage = pconnector2->get();
+        if (!pmessage)
+        {
+            boost::this_thread::yield();
+            continue;
+        }
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        const size_t size = 1 + i * 37 % buffer.size();
+        BOOST_REQUIRE_EQUAL(pmessage->unpack(&buffer[0]), size);
+        for (size_t k = 0; k < size; ++k)
+        {
+            BOOST_REQUIRE_EQUAL(buffer[k], uint8_t(i + k));
+        }
+        BOOST_REQUIRE(pconnector2->pop());
+        ++i;
+    }
+    thread.join();
+    BOOST_REQUIRE(!pconnector2->get());
+}
+
+BOOST_AUTO_TEST_CASE(dual_locker_test)
+{
+    typedef connector::single_bidirectional_connector_type single_type;
+    typedef connector::multi_output_connector_type multi_output_type;
+    typedef connector::multi_bidirectional_connector_type multi_input_type;
+    check_dual_locker<
+        connector::safe_connector<connector::output_connector<single_type>,
+            connector::dual_spinlocker_interface>,
+        connector::safe_connector<connector::input_connector<single_type>,
+            connector::dual_spinlocker_interface> >("dual_locker_test1");
+    check_dual_locker<
+        connector::safe_connector<connector::output_connector<multi_output_type>,
+            connector::dual_spinlocker_with_sharable_pop_interface>,
+        connector::safe_connector<connector::input_connector<multi_input_type>,
+            connector::dual_spinlocker_with_sharable_pop_interface> >("dual_locker_test2");
+}
+
+typedef connector::safe_connector<
+    connector::bidirectional_connector<connector::single_bidirectional_connector_type>,
+    connector::robust_locker_interface> robust_connector_type;
+
+/**
+ * The robust connector that dies while it holds its locker
+ */
+class crashed_robust_connector : public robust_connector_type
+{
+public:
+    explicit crashed_robust_connector(const std::string& name) :
+        robust_connector_type(name)
+    {}
+    void crash()
+    {
+        locker().lock();
+        _exit(0);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(robust_crash_test)
+{
+    const char *name = "robust_crash_test";
+    pconnector_type pconnector1 = connector::make<robust_connector_type>(name);
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    buffer_t buffer = make_buffer(512);
+    BOOST_REQUIRE(pconnector1->push(0, &buffer[0], buffer.size()));
+    const pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (0 == pid)
+    {
+        crashed_robust_connector connector(name);
+        if (connector.open() && connector.push(1, &buffer[0], buffer.size()))
+        {
+            connector.crash();
+        }
+        _exit(1);
+    }
+    int status = -1;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_REQUIRE(WIFEXITED(status) && 0 == WEXITSTATUS(status));
+    BOOST_REQUIRE(pconnector1->push(2, &buffer[0], buffer.size()));
+    pconnector_type pconnector2 = connector::make<robust_connector_type>(name);
+    BOOST_REQUIRE(pconnector2->open());
+    const struct timespec timeout = {0, 10000000};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        pmessage_type pmessage = pconnector2->get(timeout);
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pconnector2->pop(timeout));
+    }
+    BOOST_REQUIRE(!pconnector2->get(timeout));
+}
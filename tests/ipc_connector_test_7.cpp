@@ -0,0 +1,7 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ipc_test_7
+
+#define QBUS_IPC_TEST_PARAM " 7"
+#define QBUS_IPC_TEST_PRODUCER "test_connector_producer"
+#define QBUS_IPC_TEST_CONSUMER "test_connector_consumer"
+#include "ipc_test.h"
\ No newline at end of file
@@ -0,0 +1,124 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE journal_test
+#include <boost/test/unit_test.hpp>
+
+#include "qbus/journal.h"
+#include <vector>
+#include <unistd.h>
+
+typedef std::vector<uint8_t> buffer_t;
+
+static buffer_t make_buffer(const size_t size)
+{
+    buffer_t buffer(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        buffer[i] = i;
+    }
+    return buffer;
+}
+
+using namespace qbus;
+
+struct journal_remove
+{
+    explicit journal_remove(const char *path) :
+        m_path(path)
+    {
+        remove();
+    }
+    ~journal_remove()
+    {
+        remove();
+    }
+    void remove() const
+    {
+        for (uint32_t i = 0; 0 == unlink(journal::segment_name(m_path, i).c_str()); ++i);
+    }
+    const char *m_path;
+};
+
+static bus::specification_type make_spec()
+{
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.keepalive_timeout = 0;
+    spec.min_capacity = 32 * 512;
+    spec.max_capacity = 64 * 512;
+    spec.capacity_factor = 50;
+    return spec;
+}
+
+static void check_replayed(bus::base_bus& bus, const size_t first, const size_t count)
+{
+    for (size_t i = first; i < first + count; ++i)
+    {
+        pmessage_type pmessage = bus.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        const buffer_t buffer = make_buffer(i + 1);
+        buffer_t data(pmessage->data_size());
+        pmessage->unpack(&data[0]);
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(buffer.begin(), buffer.end(),
+            data.begin(), data.end());
+        BOOST_REQUIRE(bus.pop());
+    }
+    BOOST_REQUIRE(!bus.get());
+}
+
+BOOST_AUTO_TEST_CASE(simple_test)
+{
+    const char *path = "journal_test";
+    journal_remove remover(path);
+    pbus_type pbus1 = bus::make<multi_output_bus_type>("test");
+    pbus_type pbus2 = bus::make<multi_input_bus_type>("test");
+    BOOST_REQUIRE(pbus1->create(make_spec()));
+    BOOST_REQUIRE(pbus2->open());
+    {
+        journal::writer writer(pbus2, path, 4096);
+        BOOST_REQUIRE_EQUAL(writer.poll(), 0);
+        for (size_t n = 0; n < 4; ++n)
+        {
+            for (size_t i = 25 * n; i < 25 * (n + 1); ++i)
+            {
+                const buffer_t buffer = make_buffer(i + 1);
+                BOOST_REQUIRE(pbus1->push(i, &buffer[0], buffer.size()));
+            }
+            BOOST_REQUIRE_EQUAL(writer.poll(), 25);
+        }
+        BOOST_REQUIRE_EQUAL(writer.count(), 100);
+        BOOST_REQUIRE(writer.close());
+    }
+    BOOST_REQUIRE_EQUAL(access(journal::segment_name(path, 1).c_str(), F_OK), 0);
+    pbus_type pbus3 = bus::make<single_bidirectional_bus_type>("replay");
+    bus::specification_type spec = make_spec();
+    spec.max_capacity = 1024 * 512;
+    BOOST_REQUIRE(pbus3->create(spec));
+    journal::replayer replayer(path);
+    BOOST_REQUIRE_EQUAL(replayer.replay(*pbus3), 100);
+    check_replayed(*pbus3, 0, 100);
+    BOOST_REQUIRE_EQUAL(replayer.replay(*pbus3, journal::RM_ORIGINAL, 60), 40);
+    check_replayed(*pbus3, 60, 40);
+}
+
+BOOST_AUTO_TEST_CASE(unsealed_test)
+{
+    const char *path = "journal_test";
+    journal_remove remover(path);
+    pbus_type pbus1 = bus::make<multi_output_bus_type>("test");
+    pbus_type pbus2 = bus::make<multi_input_bus_type>("test");
+    BOOST_REQUIRE(pbus1->create(make_spec()));
+    BOOST_REQUIRE(pbus2->open());
+    journal::writer writer(pbus2, path);
+    for (size_t i = 0; i < 10; ++i)
+    {
+        const buffer_t buffer = make_buffer(i + 1);
+        BOOST_REQUIRE(pbus1->push(i, &buffer[0], buffer.size()));
+    }
+    BOOST_REQUIRE_EQUAL(writer.poll(), 10);
+    pbus_type pbus3 = bus::make<single_bidirectional_bus_type>("replay");
+    BOOST_REQUIRE(pbus3->create(make_spec()));
+    journal::replayer replayer(path);
+    BOOST_REQUIRE_EQUAL(replayer.replay(*pbus3), 10);
+    check_replayed(*pbus3, 0, 10);
+}
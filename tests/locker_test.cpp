@@ -0,0 +1,122 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE locker_test
+#include <boost/test/unit_test.hpp>
+
+#include "qbus/locker.h"
+#include "qbus/common.h"
+#include <boost/thread.hpp>
+
+using namespace qbus;
+
+BOOST_AUTO_TEST_CASE(fair_locker_test)
+{
+    shared_fair_locker locker;
+    const struct timespec timeout = {0, 10000000};
+    BOOST_REQUIRE(locker.try_lock());
+    BOOST_REQUIRE(!locker.try_lock());
+    BOOST_REQUIRE(!locker.try_lock_sharable());
+    BOOST_REQUIRE(!locker.timed_lock_sharable(timeout));
+    locker.unlock();
+    locker.lock_sharable();
+    BOOST_REQUIRE(locker.try_lock_sharable());
+    BOOST_REQUIRE(!locker.try_lock());
+    BOOST_REQUIRE(!locker.timed_lock(timeout));
+    BOOST_REQUIRE(locker.try_lock_sharable());
+    locker.unlock_sharable();
+    locker.unlock_sharable();
+    locker.unlock_sharable();
+    BOOST_REQUIRE(locker.timed_lock(timeout));
+    locker.unlock();
+    locker.lock();
+    locker.unlock();
+    BOOST_REQUIRE(locker.try_lock_sharable());
+    locker.unlock_sharable();
+}
+
+struct fair_locker_context
+{
+    fair_locker_context() :
+        stop(false),
+        value(0),
+        failures(0)
+    {}
+    shared_fair_locker locker;
+    volatile bool stop;
+    volatile uint32_t value;
+    volatile uint32_t failures;
+};
+
+static void read_loop(fair_locker_context *pcontext)
+{
+    while (!pcontext->stop)
+    {
+        if (pcontext->locker.try_lock_sharable())
+        {
+            if (pcontext->value % 2 != 0)
+            {
+                ++pcontext->failures;
+            }
+            pcontext->locker.unlock_sharable();
+        }
+        pcontext->locker.lock_sharable();
+        if (pcontext->value % 2 != 0)
+        {
+            ++pcontext->failures;
+        }
+        pcontext->locker.unlock_sharable();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fair_writer_test)
+{
+    fair_locker_context context;
+    boost::thread_group readers;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        readers.create_thread(boost::bind(read_loop, &context));
+    }
+    const size_t count = 10000;
+    const struct timespec start = get_monotonic_time();
+    for (size_t i = 0; i < count; ++i)
+    {
+        context.locker.lock();
+        ++context.value;
+        ++context.value;
+        context.locker.unlock();
+    }
+    const struct timespec elapsed = get_monotonic_time() - start;
+    context.stop = true;
+    readers.join_all();
+    BOOST_REQUIRE_EQUAL(context.value, 2 * count);
+    BOOST_REQUIRE_EQUAL(context.failures, 0);
+    const struct timespec limit = {10, 0};
+    BOOST_REQUIRE(elapsed < limit);
+}
+
+static void try_pi_lock(shared_pi_locker *plocker, bool *presult)
+{
+    *presult = plocker->try_lock();
+    if (*presult)
+    {
+        plocker->unlock();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pi_locker_test)
+{
+    shared_pi_locker locker;
+    const struct timespec timeout = {0, 10000000};
+    bool result = true;
+    locker.lock();
+    boost::thread thread(boost::bind(try_pi_lock, &locker, &result));
+    thread.join();
+    BOOST_REQUIRE(!result);
+    locker.unlock();
+    BOOST_REQUIRE(locker.timed_lock(timeout));
+    locker.unlock();
+    BOOST_REQUIRE(locker.try_lock_sharable());
+    locker.unlock_sharable();
+    boost::thread thread2(boost::bind(try_pi_lock, &locker, &result));
+    thread2.join();
+    BOOST_REQUIRE(result);
+}
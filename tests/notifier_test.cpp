@@ -0,0 +1,121 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE notifier_test
+#include <boost/test/unit_test.hpp>
+
+#include "qbus/bus.h"
+#include <vector>
+#include <poll.h>
+
+typedef std::vector<uint8_t> buffer_t;
+
+static buffer_t make_buffer(const size_t size)
+{
+    buffer_t buffer(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        buffer[i] = i;
+    }
+    return buffer;
+}
+
+static bool readable(const int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+using namespace qbus;
+
+BOOST_AUTO_TEST_CASE(connector_test)
+{
+    pconnector_type pconnector1 = connector::make<single_output_connector_type>("notifier_test");
+    pconnector_type pconnector2 = connector::make<single_input_connector_type>("notifier_test");
+    BOOST_REQUIRE_EQUAL(pconnector2->native_handle(), -1);
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    BOOST_REQUIRE_EQUAL(pconnector1->native_handle(), -1);
+    const int fd = pconnector2->native_handle();
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_REQUIRE_EQUAL(pconnector2->native_handle(), fd);
+    BOOST_REQUIRE(!readable(fd));
+    buffer_t buffer = make_buffer(512);
+    BOOST_REQUIRE(pconnector1->push(0, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(readable(fd));
+    BOOST_REQUIRE(pconnector1->push(1, &buffer[0], buffer.size()));
+    for (size_t i = 0; i < 2; ++i)
+    {
+        pmessage_type pmessage = pconnector2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pconnector2->pop());
+    }
+    BOOST_REQUIRE(readable(fd));
+    BOOST_REQUIRE(!pconnector2->get());
+    BOOST_REQUIRE(!readable(fd));
+    BOOST_REQUIRE(pconnector1->push(2, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(readable(fd));
+}
+
+BOOST_AUTO_TEST_CASE(multi_test)
+{
+    pconnector_type pconnector1 = connector::make<multi_output_connector_type>("notifier_multi_test");
+    pconnector_type pconnector2 = connector::make<multi_input_connector_type>("notifier_multi_test");
+    pconnector_type pconnector3 = connector::make<multi_input_connector_type>("notifier_multi_test");
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    BOOST_REQUIRE(pconnector3->open());
+    const int fd2 = pconnector2->native_handle();
+    const int fd3 = pconnector3->native_handle();
+    BOOST_REQUIRE(fd2 >= 0);
+    BOOST_REQUIRE(fd3 >= 0);
+    buffer_t buffer = make_buffer(512);
+    BOOST_REQUIRE(pconnector1->push(0, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(readable(fd2));
+    BOOST_REQUIRE(readable(fd3));
+    BOOST_REQUIRE(pconnector2->get());
+    BOOST_REQUIRE(pconnector2->pop());
+    BOOST_REQUIRE(!pconnector2->get());
+    BOOST_REQUIRE(!readable(fd2));
+    BOOST_REQUIRE(readable(fd3));
+    pconnector3.reset();
+    BOOST_REQUIRE(pconnector1->push(1, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(readable(fd2));
+}
+
+BOOST_AUTO_TEST_CASE(bus_test)
+{
+    pbus_type pbus1 = bus::make<single_output_bus_type>("notifier_bus");
+    pbus_type pbus2 = bus::make<single_input_bus_type>("notifier_bus");
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.keepalive_timeout = 0;
+    spec.min_capacity = 8 * 512;
+    spec.max_capacity = 64 * 512;
+    spec.capacity_factor = 50;
+    BOOST_REQUIRE(pbus1->create(spec));
+    BOOST_REQUIRE(pbus2->open());
+    const int fd = pbus2->native_handle();
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_REQUIRE(!readable(fd));
+    buffer_t buffer = make_buffer(512);
+    const size_t count = 16;
+    for (size_t i = 0; i < count; ++i)
+    {
+        BOOST_REQUIRE(pbus1->push(i, &buffer[0], buffer.size()));
+    }
+    BOOST_REQUIRE(readable(fd));
+    for (size_t i = 0; i < count; ++i)
+    {
+        pmessage_type pmessage = pbus2->get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pbus2->pop());
+    }
+    BOOST_REQUIRE(!pbus2->get());
+    BOOST_REQUIRE(!readable(fd));
+    BOOST_REQUIRE(pbus1->push(count, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(readable(fd));
+}
@@ -4,6 +4,8 @@
 
 #include "qbus/queue.h"
 #include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
 
 typedef std::vector<uint8_t> buffer_t;
 
@@ -266,3 +268,98 @@ BOOST_AUTO_TEST_CASE(keepalive_timeout_test)
     sleep(2);
     BOOST_REQUIRE(producer_queue.push(0, &buffer[0], buffer.size()));
 }
+
+static size_t resident_size(void *ptr, const size_t size)
+{
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> pages((size + page_size - 1) / page_size);
+    BOOST_REQUIRE_EQUAL(mincore(ptr, size, &pages[0]), 0);
+    size_t result = 0;
+    for (size_t i = 0; i < pages.size(); ++i)
+    {
+        result += (pages[i] & 1) ? page_size : 0;
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(reclaim_test)
+{
+    const size_t capacity = 64 * 4096;
+    const size_t message_size = 1024;
+    const size_t size = queue::simple_queue::static_size(capacity);
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    BOOST_REQUIRE(memory != MAP_FAILED);
+    {
+        queue::simple_queue producer_queue(0, memory, capacity);
+        queue::simple_queue consumer_queue(memory);
+
+        buffer_t buffer = make_buffer(message_size);
+        for (size_t n = 0; n < 3; ++n)
+        {
+            size_t count = 0;
+            while (producer_queue.push(count, &buffer[0], buffer.size()))
+            {
+                ++count;
+            }
+            BOOST_REQUIRE(count > 0);
+            BOOST_REQUIRE(resident_size(memory, size) >= capacity);
+            for (size_t i = 0; i < count; ++i)
+            {
+                pmessage_type pmessage = consumer_queue.get();
+                BOOST_REQUIRE(pmessage);
+                BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+                buffer_t data(pmessage->data_size());
+                pmessage->unpack(&data[0]);
+                BOOST_REQUIRE_EQUAL_COLLECTIONS(buffer.begin(), buffer.end(),
+                    data.begin(), data.end());
+                BOOST_REQUIRE(consumer_queue.pop());
+            }
+            BOOST_REQUIRE(consumer_queue.empty());
+            BOOST_REQUIRE(producer_queue.reclaim() >= capacity - 2 * 4096);
+            BOOST_REQUIRE(resident_size(memory, size) <= 3 * 4096);
+        }
+    }
+    munmap(memory, size);
+}
+
+BOOST_AUTO_TEST_CASE(repair_test)
+{
+    const size_t capacity = 1024;
+    buffer_t queue_buffer(queue::simple_queue::static_size(capacity));
+    queue::simple_queue queue(0, &queue_buffer[0], capacity);
+    /* the count of messages is the 4th word of the header */
+    uint32_t *pcount = reinterpret_cast<uint32_t*>(&queue_buffer[3 * sizeof(uint32_t)]);
+    BOOST_REQUIRE_EQUAL(queue.repair(), 0);
+    buffer_t buffer = make_buffer(100);
+    size_t first = 0;
+    size_t last = 0;
+    for (size_t n = 0; n < 20; ++n)
+    {
+        while (queue.push(last, &buffer[0], buffer.size() - n))
+        {
+            ++last;
+        }
+        const size_t count = last - first;
+        *pcount = 0;
+        BOOST_REQUIRE_EQUAL(queue.repair(), count);
+        *pcount = count + 1;
+        BOOST_REQUIRE_EQUAL(queue.repair(), count);
+        BOOST_REQUIRE_EQUAL(queue.count(), count);
+        for (size_t i = 0; i < count / 2 + 1; ++i)
+        {
+            pmessage_type pmessage = queue.get();
+            BOOST_REQUIRE(pmessage);
+            BOOST_REQUIRE_EQUAL(pmessage->tag(), first);
+            BOOST_REQUIRE(queue.pop());
+            ++first;
+        }
+        BOOST_REQUIRE_EQUAL(queue.repair(), last - first);
+    }
+    while (queue.pop())
+    {
+        ++first;
+    }
+    BOOST_REQUIRE_EQUAL(first, last);
+    BOOST_REQUIRE_EQUAL(queue.repair(), 0);
+}
@@ -0,0 +1,75 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE realtime_test
+#include <boost/test/unit_test.hpp>
+
+#include "qbus/realtime.h"
+#include <vector>
+#include <sched.h>
+
+using namespace qbus;
+
+class counting_loop : public realtime::consumer_loop
+{
+public:
+    explicit counting_loop(const pconnector_type& pconnector) :
+        realtime::consumer_loop(pconnector),
+        m_tags(0)
+    {}
+    ~counting_loop()
+    {
+        stop();
+    }
+    uint64_t tags() const
+    {
+        return m_tags;
+    }
+protected:
+    //virtual
+    void do_handle(const pmessage_type& pmessage)
+    {
+        m_tags += pmessage->tag();
+    }
+private:
+    volatile uint64_t m_tags;
+};
+
+BOOST_AUTO_TEST_CASE(pin_test)
+{
+    realtime::settings_type settings;
+    BOOST_REQUIRE(realtime::pin(settings));
+    settings.cpu = 0;
+    BOOST_REQUIRE(realtime::pin(settings));
+    BOOST_REQUIRE_EQUAL(sched_getcpu(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(consumer_loop_test)
+{
+    pconnector_type pconnector1 = connector::make<single_output_connector_type>("realtime_test");
+    pconnector_type pconnector2 = connector::make<single_input_connector_type>("realtime_test");
+    BOOST_REQUIRE(pconnector1->create(0, 32 * 512));
+    BOOST_REQUIRE(pconnector2->open());
+    counting_loop loop(pconnector2);
+    realtime::settings_type settings;
+    settings.cpu = 0;
+    BOOST_REQUIRE(loop.start(settings));
+    BOOST_REQUIRE(loop.running());
+    BOOST_REQUIRE(!loop.start(settings));
+    const size_t count = 1000;
+    std::vector<uint8_t> buffer(64, 1);
+    uint64_t tags = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        while (!pconnector1->push(i, &buffer[0], buffer.size()))
+        {
+            sched_yield();
+        }
+        tags += i;
+    }
+    while (loop.count() < count)
+    {
+        sched_yield();
+    }
+    loop.stop();
+    BOOST_REQUIRE(!loop.running());
+    BOOST_REQUIRE_EQUAL(loop.tags(), tags);
+}
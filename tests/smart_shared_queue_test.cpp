@@ -4,6 +4,7 @@
 
 #include "qbus/queue.h"
 #include <vector>
+#include <string>
 
 typedef std::vector<uint8_t> buffer_t;
 
@@ -57,6 +58,12 @@ public:
     explicit sid_mocker_queue(void *ptr) :
         base_type(ptr)
     {}
+    sid_mocker_queue(void *ptr, const typename base_type::join_type join) :
+        base_type(ptr, join)
+    {}
+    sid_mocker_queue(void *ptr, const std::string& name) :
+        base_type(ptr, name)
+    {}
     sid_mocker_queue(const id_type qid, void *ptr, const size_t cpct) :
         base_type(qid, ptr, cpct)
     {}
@@ -464,3 +471,190 @@ BOOST_AUTO_TEST_CASE(queue_subscriptions_count_test)
     }
     BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 1);
 }
+
+BOOST_AUTO_TEST_CASE(history_test)
+{
+    const size_t capacity = 1024;
+    const queue::id_type id = 1;
+    buffer_t queue_buffer = make_buffer(test_queue::static_size(capacity));
+    test_queue queue1(id, &queue_buffer[0], capacity);
+    queue1.retention(3, 0);
+    test_queue queue2(&queue_buffer[0]);
+    BOOST_REQUIRE(!queue1.get());
+    buffer_t buffer = make_buffer(32);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        BOOST_REQUIRE(queue1.push(i, &buffer[0], buffer.size()));
+    }
+    for (size_t i = 0; i < 5; ++i)
+    {
+        pmessage_type pmessage = queue2.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(queue2.pop());
+    }
+    BOOST_REQUIRE(!queue2.get());
+    BOOST_REQUIRE(!queue1.get()); // release own messages
+    BOOST_REQUIRE_EQUAL(queue1.clean(), 2);
+    {
+        test_queue queue3(&queue_buffer[0]);
+        BOOST_REQUIRE(!queue3.get());
+    }
+    {
+        test_queue queue3(&queue_buffer[0], test_queue::JOIN_HISTORY);
+        for (size_t i = 2; i < 5; ++i)
+        {
+            pmessage_type pmessage = queue3.get();
+            BOOST_REQUIRE(pmessage);
+            BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+            buffer_t data(pmessage->data_size());
+            pmessage->unpack(&data[0]);
+            BOOST_REQUIRE_EQUAL_COLLECTIONS(buffer.begin(), buffer.end(),
+                data.begin(), data.end());
+            BOOST_REQUIRE(queue3.pop());
+        }
+        BOOST_REQUIRE(!queue3.get());
+    }
+    BOOST_TEST_MESSAGE("the retained messages give way to new messages");
+    const size_t count = capacity / message::base_message::static_size(buffer.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        BOOST_REQUIRE(queue1.push(5 + i, &buffer[0], buffer.size()));
+        pmessage_type pmessage = queue2.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), 5 + i);
+        BOOST_REQUIRE(queue2.pop());
+        BOOST_REQUIRE(!queue1.get());
+    }
+    {
+        test_queue queue3(&queue_buffer[0], test_queue::JOIN_HISTORY);
+        for (size_t i = count + 2; i < count + 5; ++i)
+        {
+            pmessage_type pmessage = queue3.get();
+            BOOST_REQUIRE(pmessage);
+            BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+            BOOST_REQUIRE(queue3.pop());
+        }
+        BOOST_REQUIRE(!queue3.get());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(history_timeout_test)
+{
+    const size_t capacity = 1024;
+    const queue::id_type id = 1;
+    buffer_t queue_buffer = make_buffer(test_queue::static_size(capacity));
+    test_queue queue1(id, &queue_buffer[0], capacity);
+    queue1.retention(0, 60);
+    buffer_t buffer = make_buffer(32);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        BOOST_REQUIRE(queue1.push(i, &buffer[0], buffer.size()));
+    }
+    BOOST_REQUIRE(!queue1.get()); // release own messages
+    BOOST_REQUIRE_EQUAL(queue1.clean(), 0);
+    test_queue queue2(&queue_buffer[0], test_queue::JOIN_HISTORY);
+    for (size_t i = 0; i < 5; ++i)
+    {
+        pmessage_type pmessage = queue2.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(queue2.pop());
+    }
+    BOOST_REQUIRE(!queue2.get());
+}
+
+static void check_messages(test_queue& queue, const size_t first, const size_t last)
+{
+    for (size_t i = first; i < last; ++i)
+    {
+        pmessage_type pmessage = queue.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(queue.pop());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(durable_test)
+{
+    const size_t capacity = 1024;
+    const queue::id_type id = 1;
+    buffer_t queue_buffer = make_buffer(test_queue::static_size(capacity));
+    test_queue queue1(id, &queue_buffer[0], capacity);
+    buffer_t buffer = make_buffer(32);
+    {
+        test_queue queue2(&queue_buffer[0], "subscription");
+        BOOST_REQUIRE(queue2.durable());
+        for (size_t i = 0; i < 5; ++i)
+        {
+            BOOST_REQUIRE(queue1.push(i, &buffer[0], buffer.size()));
+        }
+        check_messages(queue2, 0, 2);
+    }
+    BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 2);
+    for (size_t i = 5; i < 7; ++i)
+    {
+        BOOST_REQUIRE(queue1.push(i, &buffer[0], buffer.size()));
+    }
+    {
+        test_queue queue2(&queue_buffer[0], "subscription");
+        BOOST_REQUIRE(queue2.durable());
+        check_messages(queue2, 2, 7);
+        BOOST_REQUIRE(!queue2.get());
+        BOOST_REQUIRE(queue1.push(7, &buffer[0], buffer.size()));
+        queue2.unsubscribe();
+    }
+    BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 1);
+    {
+        test_queue queue2(&queue_buffer[0], "subscription");
+        BOOST_REQUIRE(queue2.durable());
+        BOOST_REQUIRE(!queue2.get());
+        queue2.unsubscribe();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(durable_limit_test)
+{
+    const size_t capacity = 1024;
+    const queue::id_type id = 1;
+    buffer_t queue_buffer = make_buffer(test_queue::static_size(capacity));
+    test_queue queue1(id, &queue_buffer[0], capacity);
+    queue1.durable_limit(4);
+    buffer_t buffer = make_buffer(32);
+    {
+        test_queue queue2(&queue_buffer[0], "subscription");
+    }
+    BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 2);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        BOOST_REQUIRE(queue1.push(i, &buffer[0], buffer.size()));
+    }
+    BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 2);
+    BOOST_REQUIRE(queue1.push(4, &buffer[0], buffer.size()));
+    BOOST_REQUIRE(queue1.push(5, &buffer[0], buffer.size()));
+    BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 1);
+    BOOST_REQUIRE(!queue1.get());
+    BOOST_REQUIRE_EQUAL(queue1.clean(), 7); // the service message of queue2 and 6 messages
+    test_queue queue2(&queue_buffer[0], "subscription");
+    BOOST_REQUIRE(!queue2.get());
+    queue2.unsubscribe();
+}
+
+BOOST_AUTO_TEST_CASE(durable_overflow_test)
+{
+    const size_t capacity = 1024;
+    const queue::id_type id = 1;
+    buffer_t queue_buffer = make_buffer(test_queue::static_size(capacity));
+    test_queue queue1(id, &queue_buffer[0], capacity);
+    buffer_t buffer = make_buffer(32);
+    {
+        test_queue queue2(&queue_buffer[0], "subscription");
+    }
+    const size_t count = 2 * capacity / message::base_message::static_size(buffer.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        BOOST_REQUIRE(queue1.push(i, &buffer[0], buffer.size()));
+        BOOST_REQUIRE(!queue1.get());
+    }
+    BOOST_REQUIRE_EQUAL(queue1.subscriptions_count(), 1);
+}
@@ -0,0 +1,169 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE striped_bus_test
+#include <boost/test/unit_test.hpp>
+
+#include "qbus/striped_bus.h"
+#include <string.h>
+#include <vector>
+#include <sys/stat.h>
+#include <boost/make_shared.hpp>
+
+typedef std::vector<uint8_t> buffer_t;
+typedef boost::shared_ptr<qbus::bus::striped_bus> pstriped_bus_t;
+
+using namespace qbus;
+
+static bus::specification_type make_spec()
+{
+    bus::specification_type spec;
+    spec.id = 1;
+    spec.min_capacity = 32 * 512;
+    spec.max_capacity = 256 * 512;
+    spec.capacity_factor = 50;
+    return spec;
+}
+
+static bool exists(const std::string& name)
+{
+    struct stat st;
+    return 0 == stat(("/dev/shm/" + name).c_str(), &st);
+}
+
+BOOST_AUTO_TEST_CASE(unordered_test)
+{
+    bus::striped_bus consumer("striped_unordered");
+    BOOST_REQUIRE(consumer.create(make_spec(), 3, bus::MERGE_UNORDERED));
+    BOOST_REQUIRE(!consumer.create(make_spec(), 3, bus::MERGE_UNORDERED));
+    BOOST_REQUIRE_EQUAL(consumer.lanes(), 3U);
+    BOOST_REQUIRE_EQUAL(consumer.merge(), bus::MERGE_UNORDERED);
+    BOOST_REQUIRE(!consumer.get());
+    BOOST_REQUIRE(!consumer.pop());
+    std::vector<pstriped_bus_t> producers;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        producers.push_back(boost::make_shared<bus::striped_bus>("striped_unordered"));
+        BOOST_REQUIRE(producers.back()->open());
+        BOOST_REQUIRE(!producers.back()->open());
+    }
+    const size_t count = 100;
+    buffer_t buffer(64, 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t j = 0; j < producers.size(); ++j)
+        {
+            BOOST_REQUIRE(producers[j]->push(j * count + i, &buffer[0], buffer.size()));
+        }
+    }
+    /* every producer writes its own lane, so the lanes keep its order */
+    std::vector<size_t> next(producers.size(), 0);
+    for (size_t i = 0; i < count * producers.size(); ++i)
+    {
+        const pmessage_type pmessage = consumer.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->data_size(), buffer.size());
+        const size_t producer = pmessage->tag() / count;
+        BOOST_REQUIRE(producer < producers.size());
+        BOOST_REQUIRE_EQUAL(pmessage->tag() % count, next[producer]++);
+        BOOST_REQUIRE(consumer.pop());
+    }
+    BOOST_REQUIRE(!consumer.get());
+}
+
+BOOST_AUTO_TEST_CASE(ordered_test)
+{
+    bus::striped_bus consumer("striped_ordered");
+    BOOST_REQUIRE(consumer.create(make_spec(), 4, bus::MERGE_ORDERED));
+    std::vector<pstriped_bus_t> producers;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        producers.push_back(boost::make_shared<bus::striped_bus>("striped_ordered"));
+        BOOST_REQUIRE(producers.back()->open());
+        BOOST_REQUIRE_EQUAL(producers.back()->merge(), bus::MERGE_ORDERED);
+    }
+    const size_t count = 300;
+    for (size_t i = 0; i < count; ++i)
+    {
+        buffer_t buffer(i % 50, i);
+        BOOST_REQUIRE(producers[(i * 7) % producers.size()]->push(i, buffer.empty() ? NULL : &buffer[0], buffer.size()));
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const pmessage_type pmessage = consumer.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(pmessage == consumer.get());
+        /* the sequence of the push is stripped from the data */
+        BOOST_REQUIRE_EQUAL(pmessage->data_size(), i % 50);
+        buffer_t buffer(i % 50 + 1, 0);
+        pmessage->unpack(&buffer[0]);
+        BOOST_REQUIRE(buffer_t(i % 50, i) == buffer_t(buffer.begin(), buffer.end() - 1));
+        BOOST_REQUIRE(consumer.pop());
+    }
+    BOOST_REQUIRE(!consumer.get());
+    BOOST_REQUIRE(!consumer.pop());
+}
+
+BOOST_AUTO_TEST_CASE(group_test)
+{
+    bus::striped_bus consumer("striped_group");
+    BOOST_REQUIRE(!consumer.open());
+    BOOST_REQUIRE(consumer.create(make_spec(), 2, bus::MERGE_ORDERED));
+    std::vector<pstriped_bus_t> producers;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        producers.push_back(boost::make_shared<bus::striped_bus>("striped_group"));
+        BOOST_REQUIRE(producers.back()->open());
+    }
+    BOOST_REQUIRE(!producers[3]->join(2));
+    BOOST_REQUIRE(producers[3]->join(1));
+    /* the third producer finds all lanes claimed and shares one of them */
+    for (size_t i = 0; i < 40; ++i)
+    {
+        BOOST_REQUIRE(producers[i % 4]->push(i, &i, sizeof(i)));
+    }
+    /* the claimed lane is released by the producer that leaves */
+    producers[0]->close();
+    BOOST_REQUIRE(!producers[0]->push(40, NULL, 0));
+    for (size_t i = 0; i < 40; ++i)
+    {
+        const pmessage_type pmessage = consumer.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        size_t value = 0;
+        pmessage->unpack(&value);
+        BOOST_REQUIRE_EQUAL(value, i);
+        BOOST_REQUIRE(consumer.pop());
+    }
+    /* the producer that comes after takes the released lane */
+    BOOST_REQUIRE(producers[4]->push(40, NULL, 0));
+    const pmessage_type pmessage = consumer.get();
+    BOOST_REQUIRE(pmessage);
+    BOOST_REQUIRE_EQUAL(pmessage->tag(), 40);
+}
+
+BOOST_AUTO_TEST_CASE(lane_growth_test)
+{
+    bus::striped_bus consumer("striped_growth");
+    BOOST_REQUIRE(consumer.create(make_spec(), 2, bus::MERGE_UNORDERED));
+    bus::striped_bus producer("striped_growth");
+    BOOST_REQUIRE(producer.open());
+    buffer_t buffer(256, 1);
+    size_t count = 0;
+    while (producer.push(count, &buffer[0], buffer.size()))
+    {
+        ++count;
+    }
+    /* only the lane of the producer grows */
+    BOOST_REQUIRE(count > 64);
+    BOOST_REQUIRE(exists("striped_growth_lane0.1"));
+    BOOST_REQUIRE(exists("striped_growth_lane0.2"));
+    BOOST_REQUIRE(!exists("striped_growth_lane1.1"));
+    for (size_t i = 0; i < count; ++i)
+    {
+        const pmessage_type pmessage = consumer.get();
+        BOOST_REQUIRE(pmessage);
+        BOOST_REQUIRE_EQUAL(pmessage->tag(), i);
+        BOOST_REQUIRE(consumer.pop());
+    }
+    BOOST_REQUIRE(!consumer.get());
+}
@@ -56,6 +56,16 @@ int main(int argc, char** argv)
                 connector::bidirectional_connector<connector::simple_connector<queue::smart_shared_queue> >,
                 connector::sharable_spinlocker_with_sharable_pop_interface> >(name);
             break;
+        case 6:
+            pconnector = connector::make<connector::safe_connector<
+                connector::bidirectional_connector<connector::multi_output_connector_type>,
+                connector::sharable_futexlocker_with_sharable_pop_interface> >(name);
+            break;
+        case 7:
+            pconnector = connector::make<connector::safe_connector<
+                connector::bidirectional_connector<connector::multi_output_connector_type>,
+                connector::dual_spinlocker_with_sharable_pop_interface> >(name);
+            break;
     }
     assert(pconnector);
 #ifdef QBUS_IPC_TEST_GNUPLOT